@@ -0,0 +1,758 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// hash throughput, console CPU load, I2C availability and throughput
+// benchmark
+// results are printed to the console as CSV, one line per measurement
+// lines not starting with a digit can be ignored when parsing
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bsp.h"
+#include "hal5.h"
+
+#define MAX_SIZE (64 * 1024)
+
+// in flash, content does not matter for the measurement
+static const uint8_t flash_data[MAX_SIZE] 
+    __attribute__ ((aligned (4))) = {1};
+
+// in SRAM
+static uint8_t sram_data[MAX_SIZE] __attribute__ ((aligned (4)));
+
+static const uint32_t sizes[] = {
+    0, 1, 4, 16, 64, 256, 1024, 4096, 16384, MAX_SIZE
+};
+
+static hal5_hash_ctx_t ctx;
+
+void HardFault_Callback(const void* stack_frame)
+{
+    const hal5_exception_stack_frame_t* sf = 
+        (hal5_exception_stack_frame_t*) stack_frame;
+
+    printf("HardFault pc=0x%08lX lr=0x%08lX\n", sf->pc, sf->lr);
+    bsp_fault();
+    hal5_dump_cfsr_info();
+    __asm("bkpt 1");
+}
+
+static uint32_t measure(
+        const hal5_hash_algorithm_t algorithm,
+        const uint8_t* data,
+        const uint32_t len,
+        const bool per_word)
+{
+    const uint32_t start = DWT->CYCCNT;
+
+    hal5_hash_init_for_hash(&ctx, algorithm);
+
+    if (per_word)
+    {
+        for (uint32_t i = 0; i < len; i += 4)
+        {
+            hal5_hash_update(&ctx, data, i, len);
+        }
+    }
+    else
+    {
+        hal5_hash_update_buffer(&ctx, data, len);
+    }
+
+    hal5_hash_finalize(&ctx);
+
+    return DWT->CYCCNT - start;
+}
+
+static void run(
+        const bool icache,
+        const bool prefetch)
+{
+    if (icache) hal5_icache_enable();
+    else hal5_icache_disable();
+
+    if (prefetch) hal5_flash_enable_prefetch();
+    else hal5_flash_disable_prefetch();
+
+    const uint32_t sys_ck = hal5_rcc_get_sys_ck();
+    const uint32_t latency = (FLASH->ACR & FLASH_ACR_LATENCY_Msk) 
+        >> FLASH_ACR_LATENCY_Pos;
+
+    for (uint32_t location = 0; location < 2; location++)
+    {
+        const uint8_t* data = (location == 0) ? flash_data : sram_data;
+
+        for (uint32_t per_word = 0; per_word < 2; per_word++)
+        {
+            for (hal5_hash_algorithm_t algorithm = hal5_hash_sha1;
+                    algorithm <= hal5_hash_sha2_512;
+                    algorithm++)
+            {
+                for (uint32_t i = 0; i < (sizeof(sizes) / sizeof(uint32_t)); i++)
+                {
+                    const uint32_t size = sizes[i];
+
+                    const uint32_t cycles = measure(
+                            algorithm, data, size, per_word);
+
+                    const uint32_t cpb100 = (size == 0) ? 0 :
+                        (uint32_t) (((uint64_t) cycles * 100) / size);
+
+                    printf("%lu,%lu,%u,%u,%s,%s,%u,%lu,%lu,%lu.%02lu\n",
+                            sys_ck / 1000000, latency, icache, prefetch,
+                            (location == 0) ? "flash" : "sram",
+                            per_word ? "word" : "buffer",
+                            algorithm, size, cycles, 
+                            cpb100 / 100, cpb100 % 100);
+                }
+            }
+        }
+    }
+}
+
+// worst case step latency of the integrity scanner
+static void run_scanner(void)
+{
+    static hal5_hash_scanner_t scanner;
+    uint8_t reference[32];
+
+    hal5_hash_init_for_hash(&ctx, hal5_hash_sha2_256);
+    hal5_hash_update_buffer(&ctx, flash_data, MAX_SIZE);
+    hal5_hash_finalize_to(&ctx, reference);
+
+    printf("sys_ck_mhz,slice_size,max_step_cycles,mismatches\n");
+
+    for (uint32_t slice_size = 256; slice_size <= 16384; slice_size *= 4)
+    {
+        hal5_hash_scanner_init(
+                &scanner,
+                hal5_hash_sha2_256,
+                flash_data,
+                MAX_SIZE,
+                slice_size,
+                reference,
+                NULL);
+
+        while (!hal5_hash_scanner_step(&scanner));
+
+        printf("%lu,%lu,%lu,%lu\n",
+                hal5_rcc_get_sys_ck() / 1000000, slice_size, 
+                scanner.max_step_cycles, scanner.mismatches);
+    }
+}
+
+// messages per second, one at a time vs hal5_hash_batch_sequential
+// gain is the increase of messages per second with the batch
+static void run_batch(void)
+{
+    static hal5_hash_job_t jobs[200];
+    static uint8_t digests[200][64];
+
+    const uint32_t sys_ck = hal5_rcc_get_sys_ck();
+
+    printf("sys_ck_mhz,algorithm,msg_size,njobs,"
+            "single_msgs_per_s,batch_msgs_per_s,batch_gain_pct\n");
+
+    for (hal5_hash_algorithm_t algorithm = hal5_hash_sha1;
+            algorithm <= hal5_hash_sha2_512;
+            algorithm++)
+    {
+        for (uint32_t msg_size = 16; msg_size <= 256; msg_size *= 4)
+        {
+            const uint32_t njobs = sizeof(jobs) / sizeof(jobs[0]);
+
+            for (uint32_t i = 0; i < njobs; i++)
+            {
+                jobs[i].data = sram_data + (i * msg_size);
+                jobs[i].len = msg_size;
+                jobs[i].digest = digests[i];
+            }
+
+            uint32_t start = DWT->CYCCNT;
+
+            for (uint32_t i = 0; i < njobs; i++)
+            {
+                hal5_hash_init_for_hash(&ctx, algorithm);
+                hal5_hash_update_buffer(&ctx, jobs[i].data, jobs[i].len);
+                hal5_hash_finalize_to(&ctx, jobs[i].digest);
+            }
+
+            const uint32_t single = DWT->CYCCNT - start;
+
+            start = DWT->CYCCNT;
+
+            hal5_hash_batch_sequential(algorithm, jobs, njobs);
+
+            const uint32_t batch = DWT->CYCCNT - start;
+
+            const int32_t gain = (int32_t) 
+                (((int64_t) single - batch) * 100 / batch);
+
+            printf("%lu,%u,%lu,%lu,%lu,%lu,%ld\n",
+                    sys_ck / 1000000, algorithm, msg_size, njobs,
+                    (uint32_t) (((uint64_t) njobs * sys_ck) / single),
+                    (uint32_t) (((uint64_t) njobs * sys_ck) / batch),
+                    gain);
+        }
+    }
+}
+
+// block size of the algorithm, bytes
+static uint32_t block_size(
+        const hal5_hash_algorithm_t algorithm)
+{
+    return (algorithm <= hal5_hash_sha2_256) ? 64 : 128;
+}
+
+#define HASH_DMA_SIZE 16384
+
+// cycles per byte, hal5_hash_update_buffer (polled) vs DMA
+// CPU only waits for the completion of DMA here
+static void run_hash_dma(void)
+{
+    const hal5_hash_buffer_t buffers[] = {{sram_data, HASH_DMA_SIZE}};
+
+    hal5_dma_enable();
+
+    printf("sys_ck_mhz,algorithm,size,polled_cycles_per_byte,"
+            "dma_cycles_per_byte\n");
+
+    for (hal5_hash_algorithm_t algorithm = hal5_hash_sha1;
+            algorithm <= hal5_hash_sha2_512;
+            algorithm++)
+    {
+        const uint32_t polled = measure(
+                algorithm, sram_data, HASH_DMA_SIZE, false);
+
+        hal5_hash_init_for_hash(&ctx, algorithm);
+
+        const uint32_t start = DWT->CYCCNT;
+
+        hal5_hash_start_dma(&ctx, buffers, 1, NULL);
+        hal5_hash_wait(&ctx);
+
+        const uint32_t dma = DWT->CYCCNT - start;
+
+        const uint32_t polled100 = (uint32_t) 
+            (((uint64_t) polled * 100) / HASH_DMA_SIZE);
+        const uint32_t dma100 = (uint32_t) 
+            (((uint64_t) dma * 100) / HASH_DMA_SIZE);
+
+        printf("%lu,%u,%u,%lu.%02lu,%lu.%02lu\n",
+                hal5_rcc_get_sys_ck() / 1000000, algorithm, HASH_DMA_SIZE,
+                polled100 / 100, polled100 % 100,
+                dma100 / 100, dma100 % 100);
+    }
+}
+
+// CPU time left free while the interrupt driven hashing runs
+// the same busy loop is run with and without hashing
+static void run_hash_it(void)
+{
+    printf("sys_ck_mhz,algorithm,size,free_pct\n");
+
+    for (hal5_hash_algorithm_t algorithm = hal5_hash_sha1;
+            algorithm <= hal5_hash_sha2_512;
+            algorithm++)
+    {
+        volatile uint32_t count_it = 0;
+        volatile uint32_t count_idle = 0;
+
+        hal5_hash_init_for_hash(&ctx, algorithm);
+
+        const uint32_t start = DWT->CYCCNT;
+
+        hal5_hash_start_it(&ctx, sram_data, HASH_DMA_SIZE, NULL);
+        while (!hal5_hash_is_completed(&ctx)) count_it++;
+
+        const uint32_t cycles = DWT->CYCCNT - start;
+
+        const uint32_t idle_start = DWT->CYCCNT;
+        while ((DWT->CYCCNT - idle_start) < cycles) count_idle++;
+
+        printf("%lu,%u,%u,%lu\n",
+                hal5_rcc_get_sys_ck() / 1000000, algorithm, HASH_DMA_SIZE,
+                (count_it * 100) / count_idle);
+    }
+}
+
+// context switch, one suspend and one resume
+// measured with a partial block kept in ctx and after whole blocks
+// the peripheral is at a block boundary in both
+static void run_hash_switch(void)
+{
+    static hal5_hash_ctx_t other_ctx;
+
+    printf("sys_ck_mhz,algorithm,partial_block_cycles,block_boundary_cycles\n");
+
+    for (hal5_hash_algorithm_t algorithm = hal5_hash_sha1;
+            algorithm <= hal5_hash_sha2_512;
+            algorithm++)
+    {
+        uint32_t cycles[2];
+
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            hal5_hash_init_for_hash(&other_ctx, algorithm);
+            hal5_hash_update_buffer(&other_ctx, sram_data, 64);
+            hal5_hash_suspend(&other_ctx);
+
+            hal5_hash_init_for_hash(&ctx, algorithm);
+            hal5_hash_update_buffer(&ctx, sram_data, 
+                    (i == 0) ? 4 : block_size(algorithm));
+
+            const uint32_t start = DWT->CYCCNT;
+
+            hal5_hash_resume(&other_ctx);
+
+            cycles[i] = DWT->CYCCNT - start;
+
+            hal5_hash_finalize(&other_ctx);
+            hal5_hash_finalize(&ctx);
+        }
+
+        printf("%lu,%u,%lu,%lu\n",
+                hal5_rcc_get_sys_ck() / 1000000, algorithm, 
+                cycles[0], cycles[1]);
+    }
+}
+
+// finalize variants, one block message
+static void run_hash_finalize(void)
+{
+    printf("sys_ck_mhz,algorithm,finalize_cycles,finalize_to_cycles,"
+            "finalize_and_compare_cycles\n");
+
+    for (hal5_hash_algorithm_t algorithm = hal5_hash_sha1;
+            algorithm <= hal5_hash_sha2_512;
+            algorithm++)
+    {
+        uint32_t cycles[3];
+        uint8_t out[64] = {0};
+
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            hal5_hash_init_for_hash(&ctx, algorithm);
+            hal5_hash_update_buffer(&ctx, sram_data, block_size(algorithm));
+
+            const uint32_t start = DWT->CYCCNT;
+
+            switch (i)
+            {
+                case 0: 
+                    hal5_hash_finalize(&ctx); 
+                    break;
+                case 1: 
+                    hal5_hash_finalize_to(&ctx, out); 
+                    break;
+                case 2: 
+                    hal5_hash_finalize_and_compare(&ctx, out,
+                            hal5_hash_get_digest_size(algorithm));
+                    break;
+            }
+
+            cycles[i] = DWT->CYCCNT - start;
+        }
+
+        printf("%lu,%u,%lu,%lu,%lu\n",
+                hal5_rcc_get_sys_ck() / 1000000, algorithm, 
+                cycles[0], cycles[1], cycles[2]);
+    }
+}
+
+// CPU load of console output, polled vs TX buffer vs TX DMA
+// TX DMA is measured with acquire and commit of a line, and with
+// hal5_console_write of each character (dma_write)
+// same lines are formatted and written, then an idle loop runs
+// until the end of a window 5/4 of the transmission time
+// load is the cycles the idle loop lost compared to no output at all,
+// as a percentage of the transmission time
+
+#define CONSOLE_LINES 32
+#define CONSOLE_LINE_LEN 64
+
+static uint8_t console_buffer[1024];
+static uint8_t console_dma_buffers[2][512];
+
+static uint32_t console_idle(
+        const uint32_t start,
+        const uint32_t window)
+{
+    volatile uint32_t n = 0;
+
+    while ((DWT->CYCCNT - start) < window) n++;
+
+    return n;
+}
+
+static uint32_t console_output(
+        const uint32_t mode,
+        const uint32_t window)
+{
+    char line[CONSOLE_LINE_LEN + 1];
+
+    const uint32_t start = DWT->CYCCNT;
+
+    for (uint32_t i = 0; i < CONSOLE_LINES; i++)
+    {
+        if (mode == 2)
+        {
+            // formatted in place in the DMA buffer
+            char* p = (char*) hal5_lpuart_tx_dma_acquire(
+                    CONSOLE_LINE_LEN + 1);
+            snprintf(p, CONSOLE_LINE_LEN + 1, 
+                    "# %02lu %058lu\n", i, start);
+            hal5_lpuart_tx_dma_commit(CONSOLE_LINE_LEN);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), 
+                    "# %02lu %058lu\n", i, start);
+            for (uint32_t j = 0; j < CONSOLE_LINE_LEN; j++)
+            {
+                hal5_console_write(line[j]);
+            }
+        }
+    }
+
+    const uint32_t idle = console_idle(start, window);
+
+    hal5_lpuart_flush();
+
+    return idle;
+}
+
+static void run_console(void)
+{
+    const uint32_t sys_ck = hal5_rcc_get_sys_ck();
+
+    // 10 bits per character, 8N1, and a margin
+    const uint32_t bits = CONSOLE_LINES * CONSOLE_LINE_LEN * 10;
+    const uint32_t window = (uint32_t) 
+        (((uint64_t) bits * sys_ck * 5) / (921600 * 4));
+
+    hal5_lpuart_flush();
+
+    const uint32_t baseline = console_idle(DWT->CYCCNT, window);
+
+    uint32_t idle[4];
+
+    idle[0] = console_output(0, window);
+
+    hal5_lpuart_enable_tx_buffer(
+            console_buffer, sizeof(console_buffer),
+            hal5_lpuart_overflow_block);
+    idle[1] = console_output(1, window);
+
+    hal5_lpuart_enable_tx_dma(
+            console_dma_buffers[0], console_dma_buffers[1],
+            sizeof(console_dma_buffers[0]));
+    idle[2] = console_output(2, window);
+    idle[3] = console_output(3, window);
+
+    hal5_lpuart_disable_tx_buffer();
+
+    printf("sys_ck_mhz,bytes,polled_load_pct,buffer_load_pct,"
+            "dma_load_pct,dma_write_load_pct\n");
+
+    printf("%lu,%u", sys_ck / 1000000, CONSOLE_LINES * CONSOLE_LINE_LEN);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        const uint32_t busy = (idle[i] < baseline) ? (baseline - idle[i]) : 0;
+        printf(",%lu", (uint32_t) (((uint64_t) busy * 125) / baseline));
+    }
+    printf("\n");
+}
+
+// cycles of printf based console formatting (as it was before)
+// vs hal5_console_write_* functions, TX buffer is used so the
+// transmission is not measured, stdout is flushed for printf
+
+#define FORMAT_REPEAT 8
+
+static uint32_t format_cycles(
+        const uint32_t test,
+        const bool use_printf)
+{
+    hal5_lpuart_flush();
+
+    const uint32_t start = DWT->CYCCNT;
+
+    for (uint32_t i = 0; i < FORMAT_REPEAT; i++)
+    {
+        switch (test)
+        {
+            case 0:
+                if (use_printf) printf("\e[%lu;%luH", i, i);
+                else hal5_console_move_cursor(i, i);
+                break;
+
+            case 1:
+                if (use_printf) printf("%08lX", start);
+                else hal5_console_write_hex(start, 8);
+                break;
+
+            case 2:
+                if (use_printf) printf("%3lu", i);
+                else hal5_console_write_uint(i, 3);
+                break;
+
+            case 3:
+                if (use_printf) printf("\e[2K");
+                else hal5_console_clear_line();
+                break;
+        }
+
+        if (use_printf) fflush(stdout);
+    }
+
+    const uint32_t cycles = DWT->CYCCNT - start;
+
+    hal5_lpuart_flush();
+
+    return cycles / FORMAT_REPEAT;
+}
+
+static void run_format(void)
+{
+    static const char* names[] = {
+        "move_cursor", "hex", "uint", "clear_line"
+    };
+
+    uint32_t cycles[4][2];
+
+    hal5_lpuart_enable_tx_buffer(
+            console_buffer, sizeof(console_buffer),
+            hal5_lpuart_overflow_block);
+
+    for (uint32_t test = 0; test < 4; test++)
+    {
+        cycles[test][0] = format_cycles(test, true);
+        cycles[test][1] = format_cycles(test, false);
+    }
+
+    hal5_lpuart_disable_tx_buffer();
+
+    // output of the tests is on the current line
+    printf("\n");
+
+    printf("sys_ck_mhz,format,printf_cycles,direct_cycles\n");
+
+    for (uint32_t test = 0; test < 4; test++)
+    {
+        printf("%lu,%s,%lu,%lu\n", 
+                hal5_rcc_get_sys_ck() / 1000000, names[test],
+                cycles[test][0], cycles[test][1]);
+    }
+}
+
+// I2C main loop availability
+// the bus is kept busy for a window with register reads (write 1 byte, 
+// read 2 bytes) to I2C_ADDRESS, first with the blocking functions, then
+// with the queue where completed jobs are submitted again by the callback
+// availability is the idle loop count compared to no I2C transfer at all
+// an absent device only NACKs the address, bus is still busy then
+
+#define I2C_ADDRESS 0x50
+// rise and fall times of the bus, ns
+#define I2C_RISE_NS 100
+#define I2C_FALL_NS 10
+#define I2C_JOBS 4
+
+// I2C2 on NUCLEO-H563ZI
+static hal5_i2c_t i2c;
+
+static hal5_i2c_job_t i2c_jobs[I2C_JOBS];
+static uint8_t i2c_tx[I2C_JOBS][1];
+static uint8_t i2c_rx[I2C_JOBS][2];
+static volatile uint32_t i2c_completed;
+static volatile bool i2c_resubmit;
+
+static void i2c_callback(hal5_i2c_job_t* job)
+{
+    i2c_completed++;
+    if (i2c_resubmit) hal5_i2c_submit(&i2c, job);
+}
+
+static void run_i2c(void)
+{
+    const uint32_t sys_ck = hal5_rcc_get_sys_ck();
+    // 100ms
+    const uint32_t window = sys_ck / 10;
+
+    // SysTick (required for the timeout) and I2C timing depend on sys_ck
+    hal5_systick_configure();
+    hal5_i2c_configure(&i2c, 400000, I2C_RISE_NS, I2C_FALL_NS);
+
+    const uint32_t baseline = console_idle(DWT->CYCCNT, window);
+
+    // blocking, main loop does nothing else
+    uint32_t blocking = 0;
+    uint32_t start = DWT->CYCCNT;
+    while ((DWT->CYCCNT - start) < window)
+    {
+        hal5_i2c_master_write_read(
+                &i2c, I2C_ADDRESS, i2c_tx[0], 1, i2c_rx[0], 2);
+        blocking++;
+    }
+
+    // queued
+    for (uint32_t i = 0; i < I2C_JOBS; i++)
+    {
+        i2c_jobs[i].address = I2C_ADDRESS;
+        i2c_jobs[i].tx = i2c_tx[i];
+        i2c_jobs[i].tx_len = 1;
+        i2c_jobs[i].rx = i2c_rx[i];
+        i2c_jobs[i].rx_len = 2;
+        i2c_jobs[i].callback = i2c_callback;
+    }
+
+    hal5_i2c_enable_queue(&i2c);
+
+    i2c_completed = 0;
+    i2c_resubmit = true;
+    start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < I2C_JOBS; i++) hal5_i2c_submit(&i2c, &i2c_jobs[i]);
+    const uint32_t idle = console_idle(start, window);
+    const uint32_t queued = i2c_completed;
+    i2c_resubmit = false;
+
+    while (hal5_i2c_get_queue_length(&i2c) > 0) hal5_i2c_poll(&i2c);
+
+    hal5_i2c_disable_queue(&i2c);
+
+    printf("sys_ck_mhz,blocking_tps,queued_tps,queued_availability_pct\n");
+    printf("%lu,%lu,%lu,%lu\n",
+            sys_ck / 1000000,
+            blocking * 10,
+            queued * 10,
+            (uint32_t) (((uint64_t) idle * 100) / baseline));
+}
+
+// I2C bulk read throughput
+// I2C_BULK_LEN bytes are read from I2C_ADDRESS (e.g. EEPROM, starting 
+// from memory address 0) with the blocking functions, without and with DMA
+// at each bus speed
+
+#define I2C_BULK_LEN 4096
+
+static uint8_t i2c_bulk[I2C_BULK_LEN];
+
+static uint32_t i2c_bulk_read(void)
+{
+    const uint8_t memory_address[2] = {0, 0};
+
+    const uint32_t start = DWT->CYCCNT;
+
+    const hal5_i2c_status_t status = hal5_i2c_master_write_read(
+            &i2c, I2C_ADDRESS, memory_address, 2, i2c_bulk, I2C_BULK_LEN);
+
+    const uint32_t cycles = DWT->CYCCNT - start;
+
+    if (status != hal5_i2c_ok) return 0;
+
+    return cycles;
+}
+
+static void run_i2c_bulk(void)
+{
+    static const uint32_t speeds[] = {100000, 400000, 1000000};
+
+    const uint32_t sys_ck = hal5_rcc_get_sys_ck();
+
+    printf("sys_ck_mhz,bus_khz,bytes,bytes_per_s,dma_bytes_per_s\n");
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        hal5_i2c_configure(&i2c, speeds[i], I2C_RISE_NS, I2C_FALL_NS);
+
+        const uint32_t cycles = i2c_bulk_read();
+
+        hal5_i2c_enable_dma(&i2c);
+        const uint32_t dma_cycles = i2c_bulk_read();
+        hal5_i2c_disable_dma(&i2c);
+
+        printf("%lu,%lu,%u,%lu,%lu\n",
+                sys_ck / 1000000,
+                hal5_i2c_get_speed(&i2c) / 1000,
+                I2C_BULK_LEN,
+                (cycles == 0) ? 0 : 
+                (uint32_t) (((uint64_t) I2C_BULK_LEN * sys_ck) / cycles),
+                (dma_cycles == 0) ? 0 : 
+                (uint32_t) (((uint64_t) I2C_BULK_LEN * sys_ck) / dma_cycles));
+    }
+}
+
+static void run_all(void)
+{
+    run(false, false);
+    run(false, true);
+    run(true, false);
+    run(true, true);
+    run_scanner();
+    run_batch();
+    run_hash_dma();
+    run_hash_it();
+    run_hash_switch();
+    run_hash_finalize();
+    run_console();
+    run_format();
+    run_i2c();
+    run_i2c_bulk();
+}
+
+int main(void) 
+{
+    hal5_rcc_initialize();
+
+    hal5_console_configure(921600, false);
+    hal5_console_clearscreen();
+    hal5_console_normal_colors();
+
+    bsp_configure(NULL);
+
+    hal5_hash_enable();
+    hal5_enable_cycle_counter();
+
+    hal5_i2c_init(&i2c, 2, PF0, PF1, AF4);
+
+    for (uint32_t i = 0; i < MAX_SIZE; i++) sram_data[i] = i;
+
+    printf("Hash, console and I2C benchmark\n");
+    printf("algorithm: 1=sha1 2=sha2_224 3=sha2_256 4=sha2_384 "
+            "5=sha2_512_224 6=sha2_512_256 7=sha2_512\n");
+    printf("sys_ck_mhz,latency,icache,prefetch,location,path,"
+            "algorithm,size,cycles,cycles_per_byte\n");
+
+    // reset sys_ck (hsi)
+    run_all();
+
+    // faster sys_ck, flash latency is adjusted automatically
+    hal5_change_sys_ck_to_pll1_p(240000000, NULL, NULL, NULL);
+    run_all();
+
+    printf("Hash, console and I2C benchmark completed.\n");
+
+    while (1);
+
+    return 0;
+}
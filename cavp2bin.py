@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+#
+# SPDX-FileCopyrightText: 2023 Mete Balci
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Copyright (c) 2023 Mete Balci
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# converts a CAVP SHA .rsp file (e.g. SHA256ShortMsg.rsp) to a C header
+# containing a packed binary table, used by hal5_hash_cavp_run
+#
+# each record in the table is:
+#   message length in bytes (uint32_t, little-endian)
+#   message, padded with zeros to a multiple of 4 bytes
+#   digest (MD), always a multiple of 4 bytes
+#
+# usage: cavp2bin.py SHA256ShortMsg.rsp > SHA256ShortMsg.rsp.bin.h
+#
+# usage: cavp2bin.py --host [SHA256ShortMsg.rsp ...] > host_cavp.h
+#   converts each file to a table and lists them in host_cavp_tables,
+#   the algorithm is taken from the file name, used by make host-test
+#   to run hal5_hash_cavp_run with the software SHA of host_sha.c
+#   without files, the tables are made of FIPS 180-4 example messages
+#   and the digests of hashlib
+#
+# usage: cavp2bin.py --hmac HMAC.rsp > HMAC.rsp.h
+#   converts the CAVP HMAC .rsp file to the string tables used by
+#   cavp_hmac_test in hal5_hash.c (HAL5_CAVP_HMAC_TESTS), one table per
+#   hash algorithm (cavp_test_vectors_hmac_sha1_rsp, ..._sha512_rsp)
+#   each is a list of key, msg, mac hex strings terminated by NULL
+
+import hashlib
+import os
+import struct
+import sys
+
+def parse(path):
+    records = []
+    length = None
+    msg = None
+    for line in open(path):
+        line = line.strip()
+        if line.startswith('Len ='):
+            length = int(line.split('=')[1]) // 8
+        elif line.startswith('Msg ='):
+            msg = bytes.fromhex(line.split('=')[1].strip())
+        elif line.startswith('MD ='):
+            md = bytes.fromhex(line.split('=')[1].strip())
+            # Len = 0 has Msg = 00
+            records.append((msg[:length], md))
+    return records
+
+def pack(records):
+    out = bytearray()
+    for msg, md in records:
+        out += struct.pack('<I', len(msg))
+        out += msg
+        out += bytes((4 - (len(msg) % 4)) % 4)
+        out += md
+    return out
+
+# e.g. SHA512_224ShortMsg.rsp is sha512_224
+def algorithm(path):
+    name = os.path.basename(path)
+    for suffix in ['ShortMsg.rsp', 'LongMsg.rsp']:
+        if name.endswith(suffix):
+            return name[:-len(suffix)].lower()
+    return None
+
+# hashlib name to hal5_hash_algorithm_t
+HOST_ALGORITHMS = {'sha1': 'hal5_hash_sha1',
+        'sha224': 'hal5_hash_sha2_224',
+        'sha256': 'hal5_hash_sha2_256',
+        'sha384': 'hal5_hash_sha2_384',
+        'sha512_224': 'hal5_hash_sha2_512_224',
+        'sha512_256': 'hal5_hash_sha2_512_256',
+        'sha512': 'hal5_hash_sha2_512'}
+
+# FIPS 180-4 example messages, and longer ones crossing many blocks
+# with all lengths modulo 4
+def examples(name):
+    msgs = [b'', b'abc',
+            b'abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq',
+            b'abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn'
+            b'hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu',
+            b'a' * 1000]
+    msgs += [bytes((i * 7) & 0xFF for i in range(n))
+            for n in [1, 2, 55, 56, 111, 112, 129, 1025]]
+    return [(msg, hashlib.new(name, msg).digest()) for msg in msgs]
+
+def print_table(name, table):
+    print('static const uint8_t %s[] '
+            '__attribute__ ((aligned (4))) = {' % name)
+    for i in range(0, len(table), 16):
+        print('    ' + ', '.join('0x%02X' % b for b in table[i:i+16]) + ',')
+    print('};')
+
+def host(paths):
+    print('// generated by cavp2bin.py --host')
+    tables = []
+    if len(paths) > 0:
+        for path in paths:
+            name = os.path.basename(path).lower().replace('.', '_')
+            tables.append(('cavp_test_vectors_%s_bin' % name,
+                algorithm(path), pack(parse(path))))
+    else:
+        for name in HOST_ALGORITHMS:
+            tables.append(('examples_%s_bin' % name,
+                name, pack(examples(name))))
+    for name, alg, table in tables:
+        print_table(name, table)
+    print('static const host_cavp_table_t host_cavp_tables[] = {')
+    for name, alg, table in tables:
+        print('    { "%s", %s, %d, %s, sizeof(%s) },' % (name,
+            HOST_ALGORITHMS[alg], hashlib.new(alg).digest_size, name, name))
+    print('};')
+
+# [L=n] sections of HMAC.rsp, n is the digest size of the hash
+HMAC_ALGORITHMS = {20: 'sha1', 28: 'sha224', 32: 'sha256',
+        48: 'sha384', 64: 'sha512'}
+
+def parse_hmac(path):
+    tables = {name: [] for name in HMAC_ALGORITHMS.values()}
+    name = None
+    key = None
+    msg = None
+    for line in open(path):
+        line = line.strip()
+        if line.startswith('[L='):
+            name = HMAC_ALGORITHMS[int(line[3:-1])]
+        elif line.startswith('Key ='):
+            key = line.split('=')[1].strip()
+        elif line.startswith('Msg ='):
+            msg = line.split('=')[1].strip()
+        elif line.startswith('Mac ='):
+            tables[name].append((key, msg, line.split('=')[1].strip()))
+    return tables
+
+def hmac(path):
+    tables = parse_hmac(path)
+    print('// generated by cavp2bin.py from %s' % os.path.basename(path))
+    for name in HMAC_ALGORITHMS.values():
+        print('static const char* cavp_test_vectors_hmac_%s_rsp[] = {' % name)
+        for key, msg, mac in tables[name]:
+            print('    "%s",\n    "%s",\n    "%s",' % (key, msg, mac))
+        print('    NULL')
+        print('};')
+
+def main():
+    if sys.argv[1] == '--hmac':
+        hmac(sys.argv[2])
+        return
+
+    if sys.argv[1] == '--host':
+        host(sys.argv[2:])
+        return
+
+    path = sys.argv[1]
+    name = os.path.basename(path).lower().replace('.', '_')
+    table = pack(parse(path))
+    print('// generated by cavp2bin.py from %s' % os.path.basename(path))
+    print_table('cavp_test_vectors_%s_bin' % name, table)
+
+if __name__ == '__main__':
+    main()
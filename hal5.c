@@ -69,29 +69,44 @@ void hal5_dump_cfsr_info(void)
 {
     const uint32_t cfsr = SCB->CFSR;
 
-    CONSOLE("CFSR, Configurable Fault Status Register [0x%08lX]:\n", cfsr);
+    // not in a fault handler
+    hal5_console_flush_stdout();
+
+    hal5_console_write_string(
+            "CFSR, Configurable Fault Status Register [0x");
+    hal5_console_write_hex(cfsr, 8);
+    hal5_console_write_string("]:\n");
 
     for (uint32_t pos = 0; pos < 32; pos++)
     {
         if (cfsr & (1 << pos)) 
         {
             const char* desc = CFSR_BIT_DESCRIPTIONS[pos];
-            CONSOLE("  %s\n", desc);
+            hal5_console_write_string("  ");
+            hal5_console_write_string(desc);
+            hal5_console_write('\n');
 
             // MMARVALID
             if (pos == SCB_CFSR_MMARVALID_Pos)
             {
                 // MMFAR
-                CONSOLE("    MMFAR=0x%08lX\n", SCB->MMFAR);
+                hal5_console_write_string("    MMFAR=0x");
+                hal5_console_write_hex(SCB->MMFAR, 8);
+                hal5_console_write('\n');
             }
             // BFARVALID
             else if (pos == SCB_CFSR_BFARVALID_Pos)
             {
                 // BFAR
-                CONSOLE("    BFAR=0x%08lX\n", SCB->BFAR);
+                hal5_console_write_string("    BFAR=0x");
+                hal5_console_write_hex(SCB->BFAR, 8);
+                hal5_console_write('\n');
             }
         }
     }
+
+    // LPUART1 interrupt cannot run in a fault handler
+    hal5_lpuart_flush_fault();
 }
 
 void hal5_set_vector(
@@ -182,7 +197,8 @@ void hal5_change_sys_ck_to_pll1_p(
     }
     else
     {
-        CONSOLE("PLL config not found.\n");
+        hal5_console_flush_stdout();
+        hal5_console_write_string("PLL config not found.\n");
         assert (false);
     }
 
@@ -219,3 +235,11 @@ inline void hal5_debug_pulse()
     debug_pin_port->BSRR = debug_pin_reset;
     __DSB(); // make sure the above completed
 }
+
+void hal5_enable_cycle_counter(void)
+{
+    // DWT is enabled with trace
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    DWT->CYCCNT = 0;
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+}
@@ -24,7 +24,12 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// HAL5_HOST is defined when the parts not accessing any peripheral are
+// compiled for a PC (make host-test), hal5.h and hal5_types.h do not 
+// need the device header otherwise
+#ifndef HAL5_HOST
 #include <stm32h5xx.h>
+#endif
 
 #include "hal5_types.h"
 
@@ -38,6 +43,9 @@ void hal5_dump_cfsr_info(void);
 void hal5_debug_configure(const hal5_gpio_pin_t pin);
 void hal5_debug_pulse(void);
 
+// enables and resets DWT CYCCNT, used for benchmarks
+void hal5_enable_cycle_counter(void);
+
 void hal5_change_sys_ck(
         const hal5_rcc_sys_ck_src_t src);
 
@@ -54,6 +62,7 @@ void hal5_set_vector(
 // CACHE
 
 void hal5_icache_enable(void);
+void hal5_icache_disable(void);
 
 // CONSOLE
 
@@ -69,6 +78,53 @@ void hal5_console_write(
 bool hal5_console_read(
         char* ch);
 
+// formatting without printf, used by the console and the console screen
+// s is not 0 terminated, the number of chars written is returned
+// s has to have HAL5_CONSOLE_FORMAT_MAX_LEN chars (-2147483648)
+// width and ndigits cannot be more than HAL5_CONSOLE_FORMAT_MAX_LEN
+#define HAL5_CONSOLE_FORMAT_MAX_LEN 11
+
+// decimal, right aligned to width with spaces, width 0 is no alignment
+uint32_t hal5_console_format_uint(
+        char* s,
+        uint32_t v,
+        const uint32_t width);
+
+uint32_t hal5_console_format_int(
+        char* s,
+        const int32_t v,
+        const uint32_t width);
+
+// uppercase hex, zero padded to ndigits (max. 8), no 0x prefix
+uint32_t hal5_console_format_hex(
+        char* s,
+        uint32_t v,
+        const uint32_t ndigits);
+
+// flushes stdout, so the output of a previous printf is not written 
+// after the direct console writes below
+// it does nothing in an exception handler (IPSR is not 0)
+void hal5_console_flush_stdout(void);
+
+// these write the formatted output directly to the console
+// they do not use stdio buffer and they do not flush stdout, call 
+// hal5_console_flush_stdout first if printf is used before
+// dump functions and assert call it once at the start
+void hal5_console_write_string(
+        const char* s);
+
+void hal5_console_write_uint(
+        uint32_t v,
+        const uint32_t width);
+
+void hal5_console_write_int(
+        const int32_t v,
+        const uint32_t width);
+
+void hal5_console_write_hex(
+        uint32_t v,
+        const uint32_t ndigits);
+
 void hal5_console_clearscreen(void);
 void hal5_console_boot_colors(void);
 void hal5_console_normal_colors(void);
@@ -91,10 +147,85 @@ void hal5_console_move_cursor_left(
 void hal5_console_move_cursor_right(
         const uint32_t nlines);
 
+// CONSOLE SCREEN
+
+// buffer and shadow have to be width * height chars
+// buffer is cleared to spaces, all cells are sent at the first draw
+void hal5_console_screen_init(
+        hal5_console_screen_t* screen,
+        const uint32_t x,
+        const uint32_t y,
+        const uint32_t width,
+        const uint32_t height,
+        char* buffer,
+        char* shadow,
+        const uint32_t refresh_interval);
+
+void hal5_console_screen_clear(
+        hal5_console_screen_t* screen);
+
+// col and row are 0-based in the screen, s is clipped at the end of row
+void hal5_console_screen_put_string(
+        hal5_console_screen_t* screen,
+        const uint32_t col,
+        const uint32_t row,
+        const char* s);
+
+// formatted as hal5_console_format_uint and _hex, then put as a string
+void hal5_console_screen_put_uint(
+        hal5_console_screen_t* screen,
+        const uint32_t col,
+        const uint32_t row,
+        uint32_t v,
+        const uint32_t width);
+
+void hal5_console_screen_put_hex(
+        hal5_console_screen_t* screen,
+        const uint32_t col,
+        const uint32_t row,
+        uint32_t v,
+        const uint32_t ndigits);
+
+// sends only the changed cells, the cursor is saved and restored
+void hal5_console_screen_draw(
+        hal5_console_screen_t* screen);
+
+// draws if refresh_interval passed since the last refresh
+// returns true if it is drawn
+bool hal5_console_screen_refresh(
+        hal5_console_screen_t* screen);
+
 // CRS
 
 void hal5_crs_enable_for_usb(void);
 
+// DMA
+
+void hal5_dma_enable(void);
+
+// mem has to be aligned to width, nbytes is the total in bytes
+// channel is disabled by hardware when the transfer completes
+// callback is called from the interrupt handler, can be NULL
+void hal5_dma_start(
+        const hal5_dma_channel_t channel,
+        const hal5_dma_request_t request,
+        const bool mem_to_periph,
+        volatile void* periph,
+        const void* mem,
+        const uint32_t nbytes,
+        const hal5_dma_width_t width,
+        void (*callback)(const bool error));
+
+bool hal5_dma_is_busy(
+        const hal5_dma_channel_t channel);
+
+// bytes not yet transferred
+uint32_t hal5_dma_get_remaining(
+        const hal5_dma_channel_t channel);
+
+void hal5_dma_abort(
+        const hal5_dma_channel_t channel);
+
 // FLASH
 
 bool hal5_flash_calculate_latency(
@@ -107,6 +238,7 @@ void hal5_flash_change_latency(
         const hal5_flash_latency_t latency);
 
 void hal5_flash_enable_prefetch(void);
+void hal5_flash_disable_prefetch(void);
 
 // GPIO
 
@@ -135,9 +267,14 @@ void hal5_gpio_set(
 void hal5_gpio_reset(
         const hal5_gpio_pin_t pin);
 
+// output data (ODR), the value set by hal5_gpio_set/reset
 bool hal5_gpio_get(
         const hal5_gpio_pin_t pin);
 
+// input data (IDR), the level of the pin
+bool hal5_gpio_read(
+        const hal5_gpio_pin_t pin);
+
 void hal5_gpio_flip(
         const hal5_gpio_pin_t pin);
 
@@ -157,38 +294,450 @@ void hal5_gpio_configure_exti(
 
 void hal5_hash_enable(void);
 
+// each ctx is an independent hash stream
+// streams can be interleaved, the peripheral context is saved
+// and restored automatically when another ctx is used
+// migrating from the API without ctx: declare a hal5_hash_ctx_t (it is
+// about 670 bytes, static or global rather than on the stack) and pass
+// it as the first argument of hal5_hash_init_for_hash, _update(_buffer),
+// _finalize, _start_dma, _start_it and _get_digest
 void hal5_hash_init_for_hash(
+        hal5_hash_ctx_t* ctx,
         const hal5_hash_algorithm_t algorithm);
 
 void hal5_hash_update(
+        hal5_hash_ctx_t* ctx,
         const uint8_t* data, 
         const uint32_t offset,
         const uint32_t len);
 
-void hal5_hash_finalize(void);
+// hashes len bytes from data, can be called many times
+// data does not have to be word aligned
+// should not be mixed with hal5_hash_update
+void hal5_hash_update_buffer(
+        hal5_hash_ctx_t* ctx,
+        const uint8_t* data,
+        uint32_t len);
+
+void hal5_hash_finalize(
+        hal5_hash_ctx_t* ctx);
+
+// writes only hal5_hash_get_digest_size bytes to out
+// ctx digest (hal5_hash_get_digest) is not updated
+void hal5_hash_finalize_to(
+        hal5_hash_ctx_t* ctx,
+        uint8_t* out);
+
+// compares the first len bytes of the digest with expected
+// comparison time does not depend on the content
+// ctx digest (hal5_hash_get_digest) is not updated
+bool hal5_hash_finalize_and_compare(
+        hal5_hash_ctx_t* ctx,
+        const uint8_t* expected,
+        const uint32_t len);
 
-uint8_t* hal5_hash_get_digest(void);
+// processes the inner key phase once and keeps the result in key_ctx
+// key is not copied, key_ctx keeps the key pointer (ctx->key) and every
+// ctx started from it by hal5_hash_start_hmac copies that pointer, 
+// because the key is written again in the outer key phase (finalize)
+// so key has to outlive key_ctx and all these contexts
+void hal5_hash_init_for_hmac(
+        hal5_hash_ctx_t* key_ctx,
+        const hal5_hash_algorithm_t algorithm,
+        const uint8_t* key,
+        const uint32_t key_len);
+
+// starts an hmac in ctx from the cached key_ctx
+// then hal5_hash_update(_buffer) and hal5_hash_finalize are used as usual
+// ctx uses the key of key_ctx, see hal5_hash_init_for_hmac
+void hal5_hash_start_hmac(
+        hal5_hash_ctx_t* ctx,
+        const hal5_hash_ctx_t* key_ctx);
+
+// hashes the messages of all jobs one after the other with the same 
+// algorithm, it is not pipelined, the next message cannot be written 
+// until the digest of the current one is read, because INIT, which 
+// starts the next message, resets the digest registers
+// it only saves the per message overhead, the peripheral is 
+// initialized once, then only INIT is set per job
+void hal5_hash_batch_sequential(
+        const hal5_hash_algorithm_t algorithm,
+        const hal5_hash_job_t* jobs,
+        const uint32_t njobs);
+
+// GPDMA feeds the buffers to HASH, call after hal5_hash_init_for_hash
+// buffers have to be word aligned, and stay valid until completion
+// the buffers array is not copied, it has to stay valid as well
+// digest calculation starts automatically after the last buffer, or
+// after its last partial word written by the CPU (in the DMA interrupt)
+// callback is called from the interrupt handler, can be NULL
+// hal5_dma_enable has to be called before
+void hal5_hash_start_dma(
+        hal5_hash_ctx_t* ctx,
+        const hal5_hash_buffer_t* buffers,
+        const uint32_t nbuffers,
+        void (*callback)(void));
+
+// HASH interrupts feed data to HASH block by block
+// call after hal5_hash_init_for_hash
+// data has to stay valid until completion
+// callback is called from the interrupt handler, can be NULL
+void hal5_hash_start_it(
+        hal5_hash_ctx_t* ctx,
+        const uint8_t* data,
+        const uint32_t len,
+        void (*callback)(void));
+
+// true when the digest of a DMA or interrupt driven hashing is ready
+// hal5_hash_get_digest can be used then
+bool hal5_hash_is_completed(
+        hal5_hash_ctx_t* ctx);
+
+// sleeps (WFI) until the DMA or interrupt driven hashing is completed
+void hal5_hash_wait(
+        hal5_hash_ctx_t* ctx);
+
+// saves the peripheral context (HASH_CSRx) to ctx
+// only needed to control when the save happens
+// DIN is written only in whole blocks (NBWE words), the words of an
+// incomplete block are kept in ctx, so this is always at a block
+// boundary (DINIS=1, BUSY=0) as RM0481 requires
+void hal5_hash_suspend(
+        hal5_hash_ctx_t* ctx);
+
+// restores ctx to the peripheral, suspends the active ctx if any
+void hal5_hash_resume(
+        hal5_hash_ctx_t* ctx);
+
+uint8_t* hal5_hash_get_digest(
+        hal5_hash_ctx_t* ctx);
 
 uint32_t hal5_hash_get_digest_size(hal5_hash_algorithm_t algorithm);
 
+// runs all records of a cavp2bin.py table with backend
+// a record is the message length (uint32_t, little-endian), the message
+// padded with zeros to a multiple of 4 bytes and the digest
+// table has to be word aligned, it does not access any peripheral
+// returns the number of failed records, passed and bytes are increased
+uint32_t hal5_hash_cavp_run(
+        const hal5_hash_backend_t* backend,
+        const hal5_hash_algorithm_t algorithm,
+        const uint32_t digest_size,
+        const uint8_t* table,
+        const uint32_t table_len,
+        uint32_t* passed,
+        uint64_t* bytes);
+
+// HASH SCANNER
+
+// hashes len bytes from start in slices of slice_size bytes
+// the digest is compared with reference after the whole region
+// reference has to stay valid, its size is the digest size
+// mismatch_callback is called on each mismatch, can be NULL
+void hal5_hash_scanner_init(
+        hal5_hash_scanner_t* scanner,
+        const hal5_hash_algorithm_t algorithm,
+        const uint8_t* start,
+        const uint32_t len,
+        const uint32_t slice_size,
+        const uint8_t* reference,
+        void (*mismatch_callback)(hal5_hash_scanner_t* scanner));
+
+// hashes the next slice, e.g. called from the main loop when idle
+// returns true when a pass is completed, the next step starts a new one
+// max_step_cycles keeps the worst case step time
+// if hal5_enable_cycle_counter is called
+bool hal5_hash_scanner_step(
+        hal5_hash_scanner_t* scanner);
+
 // I2C
 
-void hal5_i2c_configure();
+// each instance (I2C1 to I2C4) has its own hal5_i2c_t handle and state,
+// so several buses can transfer at the same time (with the queue or DMA)
+// all functions other than hal5_i2c_init take the handle
+
+// n is 1 to 4, pins and af are the SCL and SDA pin mapping
+// e.g. I2C2 on NUCLEO-H563ZI: PF0 (SCL), PF1 (SDA), AF4
+// it does not access any register
+void hal5_i2c_init(
+        hal5_i2c_t* i2c,
+        const uint32_t n,
+        const hal5_gpio_pin_t scl,
+        const hal5_gpio_pin_t sda,
+        const hal5_gpio_af_t af);
+
+// TIMINGR is calculated for speed (max. 1000000, Fast-mode Plus) with 
+// the rise and fall times of the bus and the kernel clock of the instance
+// (hal5_rcc_get_i2c_ker_ck)
+// it has to be called again if the kernel clock changes
+// above 400000, Fast-mode Plus drive (SBS_PMCR) is enabled if the pins
+// are PB6 to PB9, other pins have no such control
+void hal5_i2c_configure(
+        hal5_i2c_t* i2c,
+        const uint32_t speed,
+        const uint32_t rise_ns,
+        const uint32_t fall_ns);
+
+// calculates the fastest TIMINGR meeting the I2C specification for speed,
+// actual speed is not more than speed
+// returns false if it is not possible with ker_ck, rise_ns and fall_ns
+// it does not access any register
+bool hal5_i2c_calculate_timing(
+        const uint32_t ker_ck,
+        const uint32_t speed,
+        const uint32_t rise_ns,
+        const uint32_t fall_ns,
+        hal5_i2c_timing_t* timing);
+
+// max. actual bus speed, after configure
+uint32_t hal5_i2c_get_speed(
+        hal5_i2c_t* i2c);
+
+// requires HAL5_I2C_TIMING_TESTS
+// sweeps kernel clocks and checks the RM0481 Standard-mode example 
+// timings, it also runs on a PC with make host-test
+// returns true if all pass
+bool hal5_i2c_timing_test(void);
 
 bool hal5_i2c_read(
+        hal5_i2c_t* i2c,
         uint8_t* ch);
 
 void hal5_i2c_write(
+        hal5_i2c_t* i2c,
         const uint8_t ch);
 
+// master transactions, address is 7-bit
+// these wait until the transaction is completed
+// transfers longer than 255 bytes are chained with RELOAD
+// timeout requires SysTick (hal5_ticks), hal5_systick_configure has to be
+// called before (this is asserted), on timeout I2C is reset and the bus 
+// is cleared
+// they return NACK, timeout, arbitration lost or bus error status
+
+// ms without progress in a transaction
+#define HAL5_I2C_TIMEOUT 25
+
+// len can be 0, e.g. to check if there is a device at address
+hal5_i2c_status_t hal5_i2c_master_write(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        const uint8_t* data,
+        const uint32_t len);
+
+hal5_i2c_status_t hal5_i2c_master_read(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        uint8_t* data,
+        const uint32_t len);
+
+// write, then read with a repeated start, e.g. register read
+hal5_i2c_status_t hal5_i2c_master_write_read(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        const uint8_t* wdata,
+        const uint32_t wlen,
+        uint8_t* rdata,
+        const uint32_t rlen);
+
+// interrupt driven job queue, one per instance
+// the blocking functions above cannot be used while the queue is enabled
+// max. number of jobs is HAL5_I2C_QUEUE_SIZE (hal5_types.h)
+
+void hal5_i2c_enable_queue(
+        hal5_i2c_t* i2c);
+
+// queue has to be empty, blocking functions can be used again
+void hal5_i2c_disable_queue(
+        hal5_i2c_t* i2c);
+
+// returns false if the queue is full
+// job cannot be modified until it is completed or cancelled
+bool hal5_i2c_submit(
+        hal5_i2c_t* i2c,
+        hal5_i2c_job_t* job);
+
+// a pending job is skipped, callback is not called for it
+// an active job is stopped with a STOP after the current byte and it is 
+// completed (status cancelled, callback is called) when STOP is detected
+// returns false if the job is already completed
+bool hal5_i2c_cancel(
+        hal5_i2c_t* i2c,
+        hal5_i2c_job_t* job);
+
+// checks the deadline of the active job (see hal5_i2c_job_t timeout)
+// when a job is past its deadline, I2C is reset and the bus is cleared 
+// by clocking SCL as GPIO until SDA is released and sending a STOP
+// it does not block, each call does at most one step of the bus clear 
+// (an SCL or SDA edge) and at most one step per ms (hal5_ticks)
+// when the bus is cleared, the job is completed with timeout (or 
+// cancelled, if it is cancelled but STOP could not be sent) and the 
+// next job is started
+// it has to be called periodically, not from an interrupt handler
+void hal5_i2c_poll(
+        hal5_i2c_t* i2c);
+
+// number of jobs in the queue, the active job (also when it is 
+// cancelled but not completed yet) and the pending jobs
+// cancelled pending jobs are not counted
+// it only reads the queue, hal5_i2c_poll has to be called to detect 
+// timeouts
+uint32_t hal5_i2c_get_queue_length(
+        hal5_i2c_t* i2c);
+
+// GPDMA1 moves the data of transfers of at least HAL5_I2C_DMA_THRESHOLD
+// bytes, both in the blocking functions and in the queue
+// CPU only handles the chunks of 255 bytes (TCR) and the completion
+// data has to stay valid until the transfer is completed
+// hal5_dma_enable is called by hal5_i2c_enable_dma
+// only I2C1 to I2C3, each uses two GPDMA1 channels, GPDMA1 has no 
+// channels left for I2C4 and GPDMA2 is not supported, so I2C4 cannot use
+// DMA (asserted)
+
+#define HAL5_I2C_DMA_THRESHOLD 8
+
+void hal5_i2c_enable_dma(
+        hal5_i2c_t* i2c);
+
+// queue has to be empty
+void hal5_i2c_disable_dma(
+        hal5_i2c_t* i2c);
+
+// LOG
+
+// HAL5_LOG is printf, unless HAL5_LOG_TOKENIZED is defined
+// when tokenized, format strings are kept in .hal5_log section, which is
+// not loaded to the MCU (it is an INFO section in hal5_log.ld), and only
+// the address of the format string and the arguments are sent to the
+// console, see hal5_log_decode.py
+// tokenized, the arguments have to be 32-bit (char, int, long, pointer)
+// %s, %f and 64-bit types are not supported, max. 8 arguments
+// in text mode, stdio.h has to be included
+
+#define HAL5_LOG_NARGS(...) \
+    HAL5_LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define HAL5_LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+
+#ifdef HAL5_LOG_TOKENIZED
+#define HAL5_LOG(f_, ...) do { \
+    static const char hal5_log_f_[] \
+        __attribute__ ((section (".hal5_log"), used)) = f_; \
+    hal5_log(hal5_log_f_, HAL5_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__); \
+} while (0)
+#else
+#define HAL5_LOG(f_, ...) printf((f_), ##__VA_ARGS__)
+#endif
+
+// used by HAL5_LOG, writes one record to the console
+// 0x01, COBS encoded (LEB128 format string address, LEB128 args...), 0x00
+void hal5_log(
+        const char* f,
+        const uint32_t nargs,
+        ...);
+
 // LPUART
 
+// lpuart1_ker_ck (csi_ker_ck, hsi_ker_ck or pclk3) and PRESC
+// are selected for the lowest baud rate error
+// pclk3 is used only if csi_ker_ck and hsi_ker_ck cannot meet 
+// HAL5_LPUART_MAX_ERROR_PPM, then it has to be called again after 
+// sys_ck changes
+// max. baud is lpuart1_ker_ck / 3
+
+#define HAL5_LPUART_MAX_ERROR_PPM 10000
+
 void hal5_lpuart_configure(
         const uint32_t baud);
 
+// calculates PRESC and BRR for baud from ker_ck
+// returns false if baud is not possible with ker_ck
+// it does not access any register
+bool hal5_lpuart_calculate_brr(
+        const uint32_t ker_ck,
+        const uint32_t baud,
+        hal5_lpuart_brr_t* brr);
+
+// actual baud rate and its error in ppm, after configure
+uint32_t hal5_lpuart_get_baud(void);
+int32_t hal5_lpuart_get_baud_error_ppm(void);
+
+// requires HAL5_LPUART_BRR_TESTS
+// returns true if all pass
+bool hal5_lpuart_brr_test(void);
+
 void hal5_lpuart_write(
         const char ch);
 
+// after this, hal5_lpuart_write (and the console) does not wait for
+// LPUART1 but puts the character into buffer
+// LPUART1 interrupt (TX FIFO threshold) moves it to TX FIFO
+// size is the number of bytes, has to be a power of 2
+// policy decides what happens when the buffer is full
+void hal5_lpuart_enable_tx_buffer(
+        uint8_t* buffer,
+        const uint32_t size,
+        const hal5_lpuart_overflow_t policy);
+
+// after this, LPUART1 TX uses GPDMA1 with two buffers of size bytes
+// one buffer is filled while the other one is sent
+// hal5_lpuart_write appends one character in a critical section, 
+// acquire and commit is cheaper for more than a few characters
+void hal5_lpuart_enable_tx_dma(
+        uint8_t* buffer0,
+        uint8_t* buffer1,
+        const uint32_t size);
+
+// zero-copy write in TX DMA mode
+// returns where len bytes can be written directly in the DMA buffer
+// waits until one of the buffers is sent if there is not enough space
+// len cannot be more than the size of a buffer
+// hal5_lpuart_write cannot be used until commit is called, except by 
+// the assert and fault handlers, it then writes to TDR directly
+uint8_t* hal5_lpuart_tx_dma_acquire(
+        const uint32_t len);
+
+// first len bytes written to the pointer returned by acquire are sent
+// len can be less than the len given to acquire
+void hal5_lpuart_tx_dma_commit(
+        const uint32_t len);
+
+// after this, received characters are put into buffer by LPUART1
+// interrupt, hal5_lpuart_read reads from buffer
+// an idle line after the characters marks the end of a frame
+// size is the number of bytes, has to be a power of 2
+void hal5_lpuart_enable_rx_buffer(
+        uint8_t* buffer,
+        const uint32_t size);
+
+// copies the oldest complete frame, up to max_len bytes
+// returns the length of the frame, 0 if there is no complete frame
+// if it is more than max_len, rest of the frame is discarded
+uint32_t hal5_lpuart_read_frame(
+        uint8_t* frame,
+        const uint32_t max_len);
+
+// number of hardware overrun errors (ORE) since RX buffer is enabled
+uint32_t hal5_lpuart_get_rx_overruns(void);
+
+// number of characters dropped because RX buffer was full
+uint32_t hal5_lpuart_get_rx_dropped(void);
+
+// flushes and returns to the default, waiting hal5_lpuart_write
+void hal5_lpuart_disable_tx_buffer(void);
+
+// waits until all characters are transmitted
+// it does not need the interrupt, so it can be used in a fault handler
+// it cannot be called between acquire and commit in TX DMA mode
+void hal5_lpuart_flush(void);
+
+// hal5_lpuart_flush for the assert and fault handlers
+// if a DMA buffer is acquired, it only waits for the transfer in 
+// progress, the acquired buffer is not sent
+void hal5_lpuart_flush_fault(void);
+
+// number of characters dropped or overwritten since TX buffer is enabled
+uint32_t hal5_lpuart_get_tx_dropped(void);
+
 bool hal5_lpuart_read(
         char* ch);
 
@@ -234,6 +783,8 @@ bool hal5_rcc_is_hsi48_enabled(void);
 void hal5_rcc_enable_gpio_port_by_index(
         const uint32_t port_index);
 
+void hal5_rcc_enable_gpdma1(void);
+
 void hal5_rcc_enable_hash(void);
 
 void hal5_rcc_enable_lpuart1(void);
@@ -314,6 +865,7 @@ uint32_t hal5_rcc_get_sys_ck(void);
 uint32_t hal5_rcc_get_pll1_p_ck(void);
 
 uint32_t hal5_rcc_get_fclk(void);
+uint32_t hal5_rcc_get_pclk3(void);
 uint32_t hal5_rcc_get_i2c_ker_ck(
         const uint32_t n);
 uint32_t hal5_rcc_get_lpuart1_ker_ck(void);
@@ -324,6 +876,69 @@ uint32_t hal5_rcc_get_systick_ck(void);
 void hal5_rng_enable(void);
 uint32_t hal5_rng_random(void);
 
+// RNG interrupt keeps buffer filled with random words
+// size is the number of words, has to be a power of 2
+// after this, hal5_rng_random also reads from the pool, it waits for 
+// the refill if the pool is empty, this is counted as an underrun
+void hal5_rng_enable_pool(
+        uint32_t* buffer,
+        const uint32_t size);
+
+// false if the pool is empty, this is counted as an underrun
+bool hal5_rng_try_read(
+        uint32_t* r);
+
+// fills buf from the pool, waits for the refill if the pool is empty
+// a call that had to wait is counted as an underrun
+void hal5_rng_fill(
+        uint8_t* buf,
+        uint32_t len);
+
+// number of words in the pool
+uint32_t hal5_rng_get_pool_level(void);
+
+uint32_t hal5_rng_get_pool_underruns(void);
+
+// number of clock and seed error recoveries started
+// the interrupt handler only starts a recovery (conditional reset for a
+// seed error) and returns, the pool is refilled when RNG is ready again
+uint32_t hal5_rng_get_recoveries(void);
+
+// number of recoveries followed by another error before any data
+uint32_t hal5_rng_get_recovery_failures(void);
+
+// DRBG
+// ChaCha20 based, fast key erasure construction
+// seeded and reseeded from hal5_rng_random
+// hal5_rng_enable has to be called before
+
+// reseed_interval is the number of bytes generated before
+// key is mixed with new hardware random words, 0 means never
+void hal5_drbg_init(
+        hal5_drbg_t* drbg,
+        const uint32_t reseed_interval);
+
+// deterministic instantiation, used for known answer tests
+void hal5_drbg_init_with_seed(
+        hal5_drbg_t* drbg,
+        const uint32_t seed[8],
+        const uint32_t reseed_interval);
+
+void hal5_drbg_reseed(
+        hal5_drbg_t* drbg);
+
+void hal5_drbg_generate(
+        hal5_drbg_t* drbg,
+        uint8_t* buf,
+        uint32_t len);
+
+uint32_t hal5_drbg_random(
+        hal5_drbg_t* drbg);
+
+// known answer tests, requires HAL5_DRBG_TESTS
+// returns true if all pass
+bool hal5_drbg_test(void);
+
 // SYSTICK
 
 extern volatile uint32_t hal5_ticks;
@@ -333,6 +948,39 @@ void hal5_systick_configure(void);
 void hal5_wait(
         const uint32_t milliseconds);
 
+// TELEMETRY
+
+// max. data length of a telemetry frame
+#define HAL5_TELEMETRY_MAX_LEN 240
+
+// max. length of an encoded frame
+// start, COBS overhead, type, sequence number, data, CRC, end
+#define HAL5_TELEMETRY_MAX_FRAME_LEN (1 + 1 + 3 + HAL5_TELEMETRY_MAX_LEN + 2 + 1)
+
+// sends data (e.g. a struct) as a binary frame to the console
+// type is application defined, the frames are numbered and CRC protected
+// see hal5_telemetry_frame.c for the frame format and hal5_telemetry.py
+// it is not reentrant, the sequence number and the frame bytes are not
+// protected, so it has to be called only from one context (asserted)
+void hal5_telemetry_send(
+        const uint8_t type,
+        const void* data,
+        const uint32_t len);
+
+// encodes a frame to frame (HAL5_TELEMETRY_MAX_FRAME_LEN bytes)
+// returns the length of the frame
+// it does not access any register
+uint32_t hal5_telemetry_encode(
+        const uint8_t type,
+        const uint16_t sequence,
+        const void* data,
+        const uint32_t len,
+        uint8_t* frame);
+
+// frames of the C encoder against fixed vectors
+// requires HAL5_TELEMETRY_TESTS, returns true if all pass
+bool hal5_telemetry_test(void);
+
 // WATCHDOG
 
 void hal5_watchdog_configure(
@@ -39,7 +39,20 @@ void __assert_func(
         const char* func,
         const char* failedexpr) 
 {
-    CONSOLE("ASSERT %s:%d %s() %s\n", file, line, func, failedexpr);
+    // not when assert fails in a fault handler
+    hal5_console_flush_stdout();
+
+    hal5_console_write_string("ASSERT ");
+    hal5_console_write_string(file);
+    hal5_console_write(':');
+    hal5_console_write_int(line, 0);
+    hal5_console_write(' ');
+    // func is NULL if the compiler does not provide __func__
+    if (func != NULL) hal5_console_write_string(func);
+    hal5_console_write_string("() ");
+    hal5_console_write_string(failedexpr);
+    hal5_console_write('\n');
+    hal5_lpuart_flush_fault();
     while (1); // no return
 }
 
@@ -51,7 +64,18 @@ void __assert_fail(
         unsigned int line,
         const char* function)
 {
-    CONSOLE("ASSERT %s:%u %s() %s\n", file, line, function, assertion);
+    hal5_console_flush_stdout();
+
+    hal5_console_write_string("ASSERT ");
+    hal5_console_write_string(file);
+    hal5_console_write(':');
+    hal5_console_write_uint(line, 0);
+    hal5_console_write(' ');
+    if (function != NULL) hal5_console_write_string(function);
+    hal5_console_write_string("() ");
+    hal5_console_write_string(assertion);
+    hal5_console_write('\n');
+    hal5_lpuart_flush_fault();
     while (1); // no return
 }
 
@@ -32,3 +32,10 @@ void hal5_icache_enable(void)
     // enable icache
     SET_BIT(ICACHE->CR, ICACHE_CR_EN);
 }
+
+void hal5_icache_disable(void) 
+{
+    CLEAR_BIT(ICACHE->CR, ICACHE_CR_EN);
+    // wait if an invalidation is in progress
+    while (ICACHE->SR & ICACHE_SR_BUSYF_Msk);
+}
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// Consistent Overhead Byte Stuffing
+// output has no 0x00, so 0x00 can be used as the frame delimiter
+// output is max. len + 1 + (len / 254) bytes
+uint32_t hal5_cobs_encode(
+        const uint8_t* in,
+        const uint32_t len,
+        uint8_t* out)
+{
+    uint32_t code_index = 0;
+    uint32_t n = 1;
+    uint8_t code = 1;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (in[i] == 0)
+        {
+            out[code_index] = code;
+            code_index = n++;
+            code = 1;
+        }
+        else
+        {
+            out[n++] = in[i];
+            code++;
+
+            // max. 254 non-zero bytes in a block
+            if (code == 0xFF)
+            {
+                out[code_index] = code;
+                code_index = n++;
+                code = 1;
+            }
+        }
+    }
+
+    out[code_index] = code;
+
+    return n;
+}
@@ -45,7 +45,15 @@ void hal5_console_configure(
 
 void hal5_console_dump_info() 
 {
-    CONSOLE("Console is LPUART1. %lu, 8N1.\n", baud);
+    hal5_console_flush_stdout();
+
+    hal5_console_write_string("Console is LPUART1. ");
+    hal5_console_write_uint(baud, 0);
+    hal5_console_write_string(", 8N1. Actual: ");
+    hal5_console_write_uint(hal5_lpuart_get_baud(), 0);
+    hal5_console_write_string(" (");
+    hal5_console_write_int(hal5_lpuart_get_baud_error_ppm(), 0);
+    hal5_console_write_string(" ppm).\n");
 }
 
 void hal5_console_write(
@@ -60,13 +68,154 @@ bool hal5_console_read(
     return hal5_lpuart_read(ch);
 }
 
+// formatting without printf
+
+// digits are in reverse order, right aligned to width with pad
+static uint32_t format_digits(
+        char* s,
+        const char* digits,
+        uint32_t n,
+        const uint32_t width,
+        const char pad)
+{
+    assert (width <= HAL5_CONSOLE_FORMAT_MAX_LEN);
+
+    uint32_t len = 0;
+    for (uint32_t i = n; i < width; i++) s[len++] = pad;
+    while (n > 0) s[len++] = digits[--n];
+
+    return len;
+}
+
+uint32_t hal5_console_format_uint(
+        char* s,
+        uint32_t v,
+        const uint32_t width)
+{
+    char digits[10];
+    uint32_t n = 0;
+
+    do
+    {
+        digits[n++] = '0' + (v % 10);
+        v /= 10;
+    } while (v > 0);
+
+    return format_digits(s, digits, n, width, ' ');
+}
+
+uint32_t hal5_console_format_int(
+        char* s,
+        const int32_t v,
+        const uint32_t width)
+{
+    if (v >= 0) return hal5_console_format_uint(s, v, width);
+
+    // -INT32_MIN does not fit to int32_t but fits to uint32_t
+    uint32_t u = -((uint32_t) v);
+
+    char digits[11];
+    uint32_t n = 0;
+
+    do
+    {
+        digits[n++] = '0' + (u % 10);
+        u /= 10;
+    } while (u > 0);
+
+    digits[n++] = '-';
+
+    return format_digits(s, digits, n, width, ' ');
+}
+
+uint32_t hal5_console_format_hex(
+        char* s,
+        uint32_t v,
+        const uint32_t ndigits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    assert (ndigits <= 8);
+
+    char digits[8];
+    uint32_t n = 0;
+
+    do
+    {
+        digits[n++] = hex[v & 0xF];
+        v >>= 4;
+    } while (v > 0);
+
+    return format_digits(s, digits, n, ndigits, '0');
+}
+
+// stdio cannot be used in an exception handler, it may be in use by
+// the interrupted code
+void hal5_console_flush_stdout(void)
+{
+    if (__get_IPSR() == 0) fflush(stdout);
+}
+
+// these write directly to the console, not through stdio buffer
+// stdout is not flushed here, but once by the caller (dump functions, 
+// assert) with hal5_console_flush_stdout
+
+static void write_chars(
+        const char* s,
+        const uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) hal5_console_write(s[i]);
+}
+
+void hal5_console_write_string(
+        const char* s)
+{
+    while (*s != 0) hal5_console_write(*s++);
+}
+
+void hal5_console_write_uint(
+        uint32_t v,
+        const uint32_t width)
+{
+    char s[HAL5_CONSOLE_FORMAT_MAX_LEN];
+    write_chars(s, hal5_console_format_uint(s, v, width));
+}
+
+void hal5_console_write_int(
+        const int32_t v,
+        const uint32_t width)
+{
+    char s[HAL5_CONSOLE_FORMAT_MAX_LEN];
+    write_chars(s, hal5_console_format_int(s, v, width));
+}
+
+void hal5_console_write_hex(
+        uint32_t v,
+        const uint32_t ndigits)
+{
+    char s[HAL5_CONSOLE_FORMAT_MAX_LEN];
+    write_chars(s, hal5_console_format_hex(s, v, ndigits));
+}
+
 void hal5_console_clearscreen(void) {
-    CONSOLE("\e[2J");
+    hal5_console_write_string("\e[2J");
 }
 
 static void hal5_console_setfgcolor(
         const int c) {
-    CONSOLE("\e[3%dm", c);
+    hal5_console_write_string("\e[3");
+    hal5_console_write_uint(c, 0);
+    hal5_console_write('m');
+}
+
+// ESC [ n c
+static void write_csi(
+        const uint32_t n,
+        const char c)
+{
+    hal5_console_write_string("\e[");
+    hal5_console_write_uint(n, 0);
+    hal5_console_write(c);
 }
 
 void hal5_console_normal_colors(void) {
@@ -81,48 +230,54 @@ void hal5_console_boot_colors(void) {
 
 void hal5_console_clear_line(void) 
 {
-    CONSOLE("\e[2K");
+    hal5_console_write_string("\e[2K");
 }
 
 void hal5_console_move_cursor(
         const uint32_t x, 
         const uint32_t y) 
 {
-    CONSOLE("\e[%lu;%luH", y, x);
+    hal5_console_write_string("\e[");
+    hal5_console_write_uint(y, 0);
+    hal5_console_write(';');
+    hal5_console_write_uint(x, 0);
+    hal5_console_write('H');
 }
 
 void hal5_console_move_cursor_up(
         const uint32_t nlines) 
 {
-    CONSOLE("\e[%luA", nlines);
+    write_csi(nlines, 'A');
 }
 
 void hal5_console_move_cursor_down(
         const uint32_t nlines) 
 {
-    CONSOLE("\e[%luB", nlines);
+    write_csi(nlines, 'B');
 }
 
 void hal5_console_move_cursor_left(
         const uint32_t nlines) 
 {
-    CONSOLE("\e[%luC", nlines);
+    // CUB, cursor back
+    write_csi(nlines, 'D');
 }
 
 void hal5_console_move_cursor_right(
         const uint32_t nlines) 
 {
-    CONSOLE("\e[%luD", nlines);
+    // CUF, cursor forward
+    write_csi(nlines, 'C');
 }
 
 void hal5_console_save_cursor(void)
 {
-    CONSOLE("\e7");
+    hal5_console_write_string("\e7");
 }
 
 void hal5_console_restore_cursor(void)
 {
-    CONSOLE("\e8");
+    hal5_console_write_string("\e8");
 }
 
 void hal5_console_heartbeat(void)
@@ -130,10 +285,10 @@ void hal5_console_heartbeat(void)
     hal5_console_save_cursor();
     switch (hal5_slow_ticks % 4) 
     {
-        case 0: CONSOLE("-"); break;
-        case 1: CONSOLE("\\"); break;
-        case 2: CONSOLE("|"); break;
-        case 3: CONSOLE("/"); break;
+        case 0: hal5_console_write('-'); break;
+        case 1: hal5_console_write('\\'); break;
+        case 2: hal5_console_write('|'); break;
+        case 3: hal5_console_write('/'); break;
     }
     hal5_console_restore_cursor();
 }
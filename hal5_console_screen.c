@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <stm32h5xx.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// differential rendering of a text region
+// cursor movement is chosen by the number of bytes it needs:
+// - next cell: nothing
+// - forward on the same row: rewriting the unchanged cells in between,
+//   or cursor forward (ESC [ n C), whichever is shorter
+// - otherwise: cursor position (ESC [ y ; x H)
+
+static uint32_t ndigits(
+        uint32_t v)
+{
+    uint32_t n = 1;
+    while (v >= 10)
+    {
+        v /= 10;
+        n++;
+    }
+    return n;
+}
+
+void hal5_console_screen_init(
+        hal5_console_screen_t* screen,
+        const uint32_t x,
+        const uint32_t y,
+        const uint32_t width,
+        const uint32_t height,
+        char* buffer,
+        char* shadow,
+        const uint32_t refresh_interval)
+{
+    assert (screen != NULL);
+    assert (x > 0);
+    assert (y > 0);
+    assert (width > 0);
+    assert (height > 0);
+
+    screen->x = x;
+    screen->y = y;
+    screen->width = width;
+    screen->height = height;
+    screen->buffer = buffer;
+    screen->shadow = shadow;
+    screen->refresh_interval = refresh_interval;
+    screen->last_refresh = hal5_ticks;
+    screen->bytes_sent = 0;
+
+    memset(buffer, ' ', width * height);
+    // not a printable char, so all cells are different at the first draw
+    memset(shadow, 0, width * height);
+}
+
+void hal5_console_screen_clear(
+        hal5_console_screen_t* screen)
+{
+    memset(screen->buffer, ' ', screen->width * screen->height);
+}
+
+void hal5_console_screen_put_string(
+        hal5_console_screen_t* screen,
+        const uint32_t col,
+        const uint32_t row,
+        const char* s)
+{
+    assert (row < screen->height);
+
+    char* cells = &screen->buffer[row * screen->width];
+
+    for (uint32_t i = col; (i < screen->width) && (*s != 0); i++)
+    {
+        cells[i] = *s++;
+    }
+}
+
+void hal5_console_screen_put_uint(
+        hal5_console_screen_t* screen,
+        const uint32_t col,
+        const uint32_t row,
+        uint32_t v,
+        const uint32_t width)
+{
+    char s[HAL5_CONSOLE_FORMAT_MAX_LEN + 1];
+    s[hal5_console_format_uint(s, v, width)] = 0;
+
+    hal5_console_screen_put_string(screen, col, row, s);
+}
+
+void hal5_console_screen_put_hex(
+        hal5_console_screen_t* screen,
+        const uint32_t col,
+        const uint32_t row,
+        uint32_t v,
+        const uint32_t ndigits)
+{
+    char s[HAL5_CONSOLE_FORMAT_MAX_LEN + 1];
+    s[hal5_console_format_hex(s, v, ndigits)] = 0;
+
+    hal5_console_screen_put_string(screen, col, row, s);
+}
+
+void hal5_console_screen_draw(
+        hal5_console_screen_t* screen)
+{
+    const uint32_t width = screen->width;
+    char* const buffer = screen->buffer;
+    char* const shadow = screen->shadow;
+
+    bool saved = false;
+    // terminal cursor position, 0 is unknown
+    uint32_t cursor_x = 0;
+    uint32_t cursor_y = 0;
+
+    for (uint32_t row = 0; row < screen->height; row++)
+    {
+        for (uint32_t col = 0; col < width; col++)
+        {
+            const uint32_t i = (row * width) + col;
+
+            if (buffer[i] == shadow[i]) continue;
+
+            if (!saved)
+            {
+                hal5_console_save_cursor();
+                screen->bytes_sent += 2;
+                saved = true;
+            }
+
+            const uint32_t x = screen->x + col;
+            const uint32_t y = screen->y + row;
+
+            if ((cursor_y == y) && (cursor_x != 0) && (cursor_x <= x))
+            {
+                const uint32_t gap = x - cursor_x;
+
+                if (gap == 0)
+                {
+                    // already there
+                }
+                else if (gap <= (3 + ndigits(gap)))
+                {
+                    // unchanged cells are same in buffer and shadow
+                    for (uint32_t j = i - gap; j < i; j++)
+                    {
+                        hal5_console_write(buffer[j]);
+                    }
+                    screen->bytes_sent += gap;
+                }
+                else
+                {
+                    hal5_console_move_cursor_right(gap);
+                    screen->bytes_sent += 3 + ndigits(gap);
+                }
+            }
+            else
+            {
+                hal5_console_move_cursor(x, y);
+                screen->bytes_sent += 4 + ndigits(x) + ndigits(y);
+            }
+
+            hal5_console_write(buffer[i]);
+            screen->bytes_sent++;
+            shadow[i] = buffer[i];
+
+            cursor_x = x + 1;
+            cursor_y = y;
+        }
+    }
+
+    if (saved)
+    {
+        hal5_console_restore_cursor();
+        screen->bytes_sent += 2;
+    }
+}
+
+bool hal5_console_screen_refresh(
+        hal5_console_screen_t* screen)
+{
+    const uint32_t now = hal5_ticks;
+
+    if ((now - screen->last_refresh) < screen->refresh_interval) return false;
+
+    screen->last_refresh = now;
+
+    hal5_console_screen_draw(screen);
+
+    return true;
+}
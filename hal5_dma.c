@@ -0,0 +1,231 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <stm32h5xx.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// only GPDMA1 is used
+// channels are fixed per user, see hal5_dma_channel_t
+
+static DMA_Channel_TypeDef* const dma_channels[] = {
+    GPDMA1_Channel0,
+    GPDMA1_Channel1,
+    GPDMA1_Channel2,
+    GPDMA1_Channel3,
+    GPDMA1_Channel4,
+    GPDMA1_Channel5,
+    GPDMA1_Channel6,
+    GPDMA1_Channel7
+};
+
+static void (*dma_callbacks[8])(const bool error) = {NULL};
+
+static uint32_t get_request_encoding(
+        const hal5_dma_request_t request)
+{
+    // RM0481, GPDMA1 requests table
+    switch (request)
+    {
+        case hal5_dma_request_hash_in:
+            return 89;
+
+        case hal5_dma_request_lpuart1_tx:
+            return 46;
+
+        case hal5_dma_request_i2c1_rx:
+            return 12;
+
+        case hal5_dma_request_i2c1_tx:
+            return 13;
+
+        case hal5_dma_request_i2c2_rx:
+            return 15;
+
+        case hal5_dma_request_i2c2_tx:
+            return 16;
+
+        case hal5_dma_request_i2c3_rx:
+            return 18;
+
+        case hal5_dma_request_i2c3_tx:
+            return 19;
+
+        default:
+            assert (false);
+    }
+
+    return 0;
+}
+
+static uint32_t get_width_encoding(
+        const hal5_dma_width_t width)
+{
+    switch (width)
+    {
+        case hal5_dma_width_byte: return 0b00;
+        case hal5_dma_width_halfword: return 0b01;
+        case hal5_dma_width_word: return 0b10;
+        default: assert (false);
+    }
+
+    return 0;
+}
+
+void hal5_dma_enable(void)
+{
+    hal5_rcc_enable_gpdma1();
+}
+
+void hal5_dma_start(
+        const hal5_dma_channel_t channel,
+        const hal5_dma_request_t request,
+        const bool mem_to_periph,
+        volatile void* periph,
+        const void* mem,
+        const uint32_t nbytes,
+        const hal5_dma_width_t width,
+        void (*callback)(const bool error))
+{
+    DMA_Channel_TypeDef* const ch = dma_channels[channel];
+
+    // BNDT is 16-bit
+    assert (nbytes > 0);
+    assert (nbytes <= 0xFFFF);
+
+    const uint32_t width_bits = get_width_encoding(width);
+    // both addresses and the size have to be aligned to the data width
+    assert ((((uint32_t) mem) & ((1UL << width_bits) - 1)) == 0);
+    assert ((nbytes & ((1UL << width_bits) - 1)) == 0);
+
+    // channel has to be idle
+    assert ((ch->CCR & DMA_CCR_EN) == 0);
+
+    dma_callbacks[channel] = callback;
+
+    // clear all flags
+    ch->CFCR = DMA_CFCR_TCF | DMA_CFCR_HTF | DMA_CFCR_DTEF | 
+        DMA_CFCR_ULEF | DMA_CFCR_USEF | DMA_CFCR_SUSPF | DMA_CFCR_TOF;
+
+    // no linked list
+    ch->CLLR = 0;
+
+    // same width on both sides, only memory side is incremented
+    uint32_t ctr1 = (width_bits << DMA_CTR1_SDW_LOG2_Pos) |
+        (width_bits << DMA_CTR1_DDW_LOG2_Pos);
+
+    uint32_t ctr2 = get_request_encoding(request) << DMA_CTR2_REQSEL_Pos;
+
+    if (mem_to_periph)
+    {
+        ctr1 |= DMA_CTR1_SINC;
+        // peripheral is the destination, it issues the requests
+        ctr2 |= DMA_CTR2_DREQ;
+        ch->CSAR = (uint32_t) mem;
+        ch->CDAR = (uint32_t) periph;
+    }
+    else
+    {
+        ctr1 |= DMA_CTR1_DINC;
+        ch->CSAR = (uint32_t) periph;
+        ch->CDAR = (uint32_t) mem;
+    }
+
+    ch->CTR1 = ctr1;
+    ch->CTR2 = ctr2;
+    ch->CBR1 = nbytes << DMA_CBR1_BNDT_Pos;
+
+    // transfer complete and error interrupts
+    ch->CCR = DMA_CCR_TCIE | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE;
+
+    NVIC_EnableIRQ(GPDMA1_Channel0_IRQn + channel);
+
+    SET_BIT(ch->CCR, DMA_CCR_EN);
+}
+
+bool hal5_dma_is_busy(
+        const hal5_dma_channel_t channel)
+{
+    return ((dma_channels[channel]->CCR & DMA_CCR_EN) != 0);
+}
+
+uint32_t hal5_dma_get_remaining(
+        const hal5_dma_channel_t channel)
+{
+    return ((dma_channels[channel]->CBR1 & DMA_CBR1_BNDT_Msk) 
+            >> DMA_CBR1_BNDT_Pos);
+}
+
+void hal5_dma_abort(
+        const hal5_dma_channel_t channel)
+{
+    DMA_Channel_TypeDef* const ch = dma_channels[channel];
+
+    if ((ch->CCR & DMA_CCR_EN) == 0) return;
+
+    // suspend, wait until suspended, then reset
+    SET_BIT(ch->CCR, DMA_CCR_SUSP);
+    while ((ch->CSR & DMA_CSR_SUSPF) == 0);
+    SET_BIT(ch->CCR, DMA_CCR_RESET);
+    while (ch->CCR & DMA_CCR_EN);
+
+    ch->CFCR = DMA_CFCR_TCF | DMA_CFCR_HTF | DMA_CFCR_DTEF | 
+        DMA_CFCR_ULEF | DMA_CFCR_USEF | DMA_CFCR_SUSPF | DMA_CFCR_TOF;
+
+    dma_callbacks[channel] = NULL;
+}
+
+static void dma_irq_handler(
+        const hal5_dma_channel_t channel)
+{
+    DMA_Channel_TypeDef* const ch = dma_channels[channel];
+
+    const uint32_t csr = ch->CSR;
+    const bool error = 
+        (csr & (DMA_CSR_DTEF | DMA_CSR_ULEF | DMA_CSR_USEF)) != 0;
+
+    ch->CFCR = DMA_CFCR_TCF | DMA_CFCR_HTF | DMA_CFCR_DTEF | 
+        DMA_CFCR_ULEF | DMA_CFCR_USEF | DMA_CFCR_SUSPF | DMA_CFCR_TOF;
+
+    // channel is disabled by hardware on completion or error
+    if (error) SET_BIT(ch->CCR, DMA_CCR_RESET);
+
+    void (*fn)(const bool error) = dma_callbacks[channel];
+    if (fn != NULL) fn(error);
+}
+
+// macro for GPDMA1_Channel<N>_IRQHandlers
+#define GPDMA1_Channel_IRQHandler(n) \
+    void GPDMA1_Channel ## n ## _IRQHandler(void) \
+{ \
+    dma_irq_handler(n); \
+}
+
+GPDMA1_Channel_IRQHandler(0)
+GPDMA1_Channel_IRQHandler(1)
+GPDMA1_Channel_IRQHandler(2)
+GPDMA1_Channel_IRQHandler(3)
+GPDMA1_Channel_IRQHandler(4)
+GPDMA1_Channel_IRQHandler(5)
+GPDMA1_Channel_IRQHandler(6)
+GPDMA1_Channel_IRQHandler(7)
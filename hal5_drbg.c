@@ -0,0 +1,307 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// ChaCha20 (RFC 8439) used as a DRBG with fast key erasure
+// each refill generates HAL5_DRBG_BLOCKS blocks with the current key
+// first 8 words of the output replaces the key, rest is the output
+// used output is cleared, so the past output cannot be recovered
+// from the state
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QR(a, b, c, d) \
+    a += b; d ^= a; d = ROTL(d, 16); \
+    c += d; b ^= c; b = ROTL(b, 12); \
+    a += b; d ^= a; d = ROTL(d, 8); \
+    c += d; b ^= c; b = ROTL(b, 7);
+
+static void chacha20_block(
+        const uint32_t key[8],
+        const uint32_t counter,
+        const uint32_t nonce[3],
+        uint32_t out[16])
+{
+    const uint32_t in[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3],
+        key[4], key[5], key[6], key[7],
+        counter, nonce[0], nonce[1], nonce[2]
+    };
+
+    uint32_t x0 = in[0], x1 = in[1], x2 = in[2], x3 = in[3];
+    uint32_t x4 = in[4], x5 = in[5], x6 = in[6], x7 = in[7];
+    uint32_t x8 = in[8], x9 = in[9], x10 = in[10], x11 = in[11];
+    uint32_t x12 = in[12], x13 = in[13], x14 = in[14], x15 = in[15];
+
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        // column rounds
+        QR(x0, x4, x8, x12);
+        QR(x1, x5, x9, x13);
+        QR(x2, x6, x10, x14);
+        QR(x3, x7, x11, x15);
+        // diagonal rounds
+        QR(x0, x5, x10, x15);
+        QR(x1, x6, x11, x12);
+        QR(x2, x7, x8, x13);
+        QR(x3, x4, x9, x14);
+    }
+
+    out[0] = x0 + in[0];
+    out[1] = x1 + in[1];
+    out[2] = x2 + in[2];
+    out[3] = x3 + in[3];
+    out[4] = x4 + in[4];
+    out[5] = x5 + in[5];
+    out[6] = x6 + in[6];
+    out[7] = x7 + in[7];
+    out[8] = x8 + in[8];
+    out[9] = x9 + in[9];
+    out[10] = x10 + in[10];
+    out[11] = x11 + in[11];
+    out[12] = x12 + in[12];
+    out[13] = x13 + in[13];
+    out[14] = x14 + in[14];
+    out[15] = x15 + in[15];
+}
+
+static void refill(
+        hal5_drbg_t* drbg)
+{
+    static const uint32_t nonce[3] = {0, 0, 0};
+
+    // key is used only for one refill, so the counter always starts at 0
+    for (uint32_t i = 0; i < HAL5_DRBG_BLOCKS; i++)
+    {
+        chacha20_block(drbg->key, i, nonce, &drbg->buffer[i * 16]);
+    }
+
+    memcpy(drbg->key, drbg->buffer, sizeof(drbg->key));
+    memset(drbg->buffer, 0, sizeof(drbg->key));
+
+    drbg->position = sizeof(drbg->key);
+}
+
+// discards the remaining output, used after the key is changed
+static void discard(
+        hal5_drbg_t* drbg)
+{
+    memset(drbg->buffer, 0, sizeof(drbg->buffer));
+    drbg->position = sizeof(drbg->buffer);
+}
+
+void hal5_drbg_init_with_seed(
+        hal5_drbg_t* drbg,
+        const uint32_t seed[8],
+        const uint32_t reseed_interval)
+{
+    assert (drbg != NULL);
+
+    memcpy(drbg->key, seed, sizeof(drbg->key));
+    discard(drbg);
+
+    drbg->reseed_interval = reseed_interval;
+    drbg->generated = 0;
+}
+
+void hal5_drbg_init(
+        hal5_drbg_t* drbg,
+        const uint32_t reseed_interval)
+{
+    uint32_t seed[8];
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        seed[i] = hal5_rng_random();
+    }
+
+    hal5_drbg_init_with_seed(drbg, seed, reseed_interval);
+
+    memset(seed, 0, sizeof(seed));
+}
+
+void hal5_drbg_reseed(
+        hal5_drbg_t* drbg)
+{
+    assert (drbg != NULL);
+
+    // new entropy is mixed into the key, not replacing it
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        drbg->key[i] ^= hal5_rng_random();
+    }
+
+    discard(drbg);
+
+    drbg->generated = 0;
+}
+
+void hal5_drbg_generate(
+        hal5_drbg_t* drbg,
+        uint8_t* buf,
+        uint32_t len)
+{
+    assert (drbg != NULL);
+    assert (buf != NULL);
+
+    if ((drbg->reseed_interval != 0) &&
+            (drbg->generated >= drbg->reseed_interval))
+    {
+        hal5_drbg_reseed(drbg);
+    }
+
+    drbg->generated += len;
+
+    uint8_t* buffer = (uint8_t*) drbg->buffer;
+
+    while (len > 0)
+    {
+        if (drbg->position == sizeof(drbg->buffer)) refill(drbg);
+
+        uint32_t n = sizeof(drbg->buffer) - drbg->position;
+        if (n > len) n = len;
+
+        memcpy(buf, &buffer[drbg->position], n);
+        memset(&buffer[drbg->position], 0, n);
+
+        drbg->position += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+uint32_t hal5_drbg_random(
+        hal5_drbg_t* drbg)
+{
+    uint32_t r;
+
+    hal5_drbg_generate(drbg, (uint8_t*) &r, sizeof(r));
+
+    return r;
+}
+
+#ifdef HAL5_DRBG_TESTS
+
+// RFC 8439 2.3.2
+static const uint32_t kat_block_key[8] = {
+    0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c,
+    0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c
+};
+
+static const uint32_t kat_block_nonce[3] = {
+    0x09000000, 0x4a000000, 0x00000000
+};
+
+static const uint8_t kat_block_out[64] = {
+    0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+    0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+    0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03,
+    0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+    0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+    0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+    0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9,
+    0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+};
+
+// RFC 8439 A.1 test vectors #1 and #2, all zero key and nonce
+// keystream bytes 32 to 63 of block 0 and block 1
+// DRBG seeded with all zero key uses block 0 bytes 0 to 31 as the next
+// key, so these are the first 96 bytes of its output
+static const uint8_t kat_a1_block_0[32] = {
+    0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d,
+    0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+    0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c,
+    0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86
+};
+
+static const uint8_t kat_a1_block_1[64] = {
+    0x9f, 0x07, 0xe7, 0xbe, 0x55, 0x51, 0x38, 0x7a,
+    0x98, 0xba, 0x97, 0x7c, 0x73, 0x2d, 0x08, 0x0d,
+    0xcb, 0x0f, 0x29, 0xa0, 0x48, 0xe3, 0x65, 0x69,
+    0x12, 0xc6, 0x53, 0x3e, 0x32, 0xee, 0x7a, 0xed,
+    0x29, 0xb7, 0x21, 0x76, 0x9c, 0xe6, 0x4e, 0x43,
+    0xd5, 0x71, 0x33, 0xb0, 0x74, 0xd8, 0x39, 0xd5,
+    0x31, 0xed, 0x1f, 0x28, 0x51, 0x0a, 0xfb, 0x45,
+    0xac, 0xe1, 0x0a, 0x1f, 0x4b, 0x79, 0x4d, 0x6f
+};
+
+// DRBG seeded with kat_block_key
+// first 32 bytes, and 32 bytes at offset 224 (start of the second refill)
+// checked with an independent ChaCha20 implementation (pyca/cryptography)
+static const uint8_t kat_drbg_out_0[32] = {
+    0x2b, 0x23, 0xcc, 0xe7, 0xa2, 0x60, 0x23, 0xab,
+    0x3f, 0x0e, 0xef, 0x69, 0x3a, 0xc8, 0x7f, 0x64,
+    0x25, 0x82, 0x35, 0xea, 0xb1, 0xf7, 0xa3, 0x2d,
+    0xc2, 0x27, 0x62, 0xa0, 0x48, 0x5b, 0x41, 0x0c
+};
+
+static const uint8_t kat_drbg_out_224[32] = {
+    0x2d, 0x41, 0xa5, 0x9c, 0x90, 0xe4, 0x1a, 0x8e,
+    0x7a, 0x4d, 0xcc, 0xaa, 0x1c, 0x46, 0x06, 0x99,
+    0x83, 0xb1, 0xa3, 0x33, 0xce, 0x25, 0x71, 0x9e,
+    0xc3, 0x43, 0x77, 0x68, 0xab, 0x57, 0xfa, 0x42
+};
+
+bool hal5_drbg_test()
+{
+    uint32_t block[16];
+
+    chacha20_block(kat_block_key, 1, kat_block_nonce, block);
+
+    const bool block_ok = (memcmp(block, kat_block_out, 64) == 0);
+
+    printf("ChaCha20 block: %s\n", block_ok ? "OK" : "FAIL");
+
+    static hal5_drbg_t drbg;
+    static const uint32_t zero_key[8] = {0};
+    uint8_t out[256];
+
+    hal5_drbg_init_with_seed(&drbg, zero_key, 0);
+    hal5_drbg_generate(&drbg, out, 96);
+
+    const bool a1_ok = 
+        (memcmp(out, kat_a1_block_0, 32) == 0) &&
+        (memcmp(&out[32], kat_a1_block_1, 64) == 0);
+
+    printf("DRBG RFC 8439 A.1: %s\n", a1_ok ? "OK" : "FAIL");
+
+    // generated in pieces to also test partial use of the buffer
+    hal5_drbg_init_with_seed(&drbg, kat_block_key, 0);
+    hal5_drbg_generate(&drbg, out, 5);
+    hal5_drbg_generate(&drbg, &out[5], 200);
+    hal5_drbg_generate(&drbg, &out[205], 51);
+
+    const bool drbg_ok = 
+        (memcmp(out, kat_drbg_out_0, 32) == 0) &&
+        (memcmp(&out[224], kat_drbg_out_224, 32) == 0);
+
+    printf("DRBG: %s\n", drbg_ok ? "OK" : "FAIL");
+
+    return block_ok && a1_ok && drbg_ok;
+}
+
+#endif
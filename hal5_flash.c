@@ -161,3 +161,10 @@ void hal5_flash_enable_prefetch()
 
     while ((FLASH->ACR & FLASH_ACR_PRFTEN) == 0);
 }
+
+void hal5_flash_disable_prefetch()
+{
+    CLEAR_BIT(FLASH->ACR, FLASH_ACR_PRFTEN);
+
+    while ((FLASH->ACR & FLASH_ACR_PRFTEN) != 0);
+}
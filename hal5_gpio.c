@@ -221,6 +221,16 @@ bool inline hal5_gpio_get(
     return (port->ODR & (1UL << pin_number));
 }
 
+bool hal5_gpio_read(
+        hal5_gpio_pin_t pin)
+{
+    const uint32_t port_index   = GPIO_PIN_TO_PORT_INDEX(pin);
+    GPIO_TypeDef* const port    = gpio_ports[port_index];
+    const uint32_t pin_number   = GPIO_PIN_TO_PIN_NUMBER(pin);
+
+    return (port->IDR & (1UL << pin_number));
+}
+
 void inline hal5_gpio_flip(
         hal5_gpio_pin_t pin)
 {
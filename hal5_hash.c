@@ -27,7 +27,9 @@
 #include "hal5.h"
 #include "hal5_private.h"
 
-static uint8_t digest[64];
+_Static_assert(HAL5_HASH_CSR_COUNT == 
+        (sizeof(((HASH_TypeDef*) 0)->CSR) / sizeof(uint32_t)),
+        "HAL5_HASH_CSR_COUNT does not match HASH_TypeDef");
 
 uint32_t hal5_hash_get_digest_size(hal5_hash_algorithm_t algorithm)
 {
@@ -125,14 +127,88 @@ void hal5_hash_enable(void)
     hal5_rcc_enable_hash();
 }
 
-static uint32_t block_size;
-static uint32_t max_word_index;
-static uint32_t nblw;
-static uint32_t word_index;
+// context currently loaded to the peripheral
+// NULL if there is none or it is finalized
+static hal5_hash_ctx_t* active_ctx = NULL;
 
-void hal5_hash_init_for_hash(
-        const hal5_hash_algorithm_t algorithm)
+void hal5_hash_suspend(
+        hal5_hash_ctx_t* ctx)
+{
+    assert (ctx == active_ctx);
+    // DMA or interrupt driven hashing cannot be interrupted
+    assert (ctx->completed);
+
+    // DIN is written only in groups of NBWE words (see write_words)
+    // so this is a block boundary, RM0481 context swapping of data
+    // loaded by software: after NBWE words, wait for DINIS and BUSY=0
+    // the words of an incomplete block are kept in ctx->pending
+    while ((HASH->SR & HASH_SR_DINIS_Msk) == 0);
+    while (HASH->SR & HASH_SR_BUSY);
+
+    ctx->imr = HASH->IMR;
+    ctx->str = HASH->STR;
+    ctx->cr = HASH->CR;
+
+    // CSR registers keep the intermediate digest and the FIFO content
+    for (uint32_t i = 0; i < HAL5_HASH_CSR_COUNT; i++)
+    {
+        ctx->csr[i] = HASH->CSR[i];
+    }
+
+    ctx->suspended = true;
+
+    active_ctx = NULL;
+}
+
+void hal5_hash_resume(
+        hal5_hash_ctx_t* ctx)
+{
+    if (ctx == active_ctx) return;
+
+    // ctx has to be suspended, not finalized
+    assert (ctx->suspended);
+
+    if (active_ctx != NULL) hal5_hash_suspend(active_ctx);
+
+    HASH->IMR = ctx->imr;
+    HASH->STR = ctx->str;
+    // INIT has to be set before the CSR registers are restored
+    HASH->CR = ctx->cr;
+    SET_BIT(HASH->CR, HASH_CR_INIT);
+
+    for (uint32_t i = 0; i < HAL5_HASH_CSR_COUNT; i++)
+    {
+        HASH->CSR[i] = ctx->csr[i];
+    }
+
+    ctx->suspended = false;
+
+    active_ctx = ctx;
+}
+
+// a phase (the message or an hmac key phase) starts with an empty FIFO
+// the first block is processed when the first word of the next block is
+// written (NBWE is block + 1 word), then each block (NBWE is block)
+static void start_phase(
+        hal5_hash_ctx_t* ctx)
+{
+    ctx->expected = ctx->max_word_index + 1;
+    ctx->npending = 0;
+    ctx->nblw = 0;
+}
+
+static void init(
+        hal5_hash_ctx_t* ctx,
+        const hal5_hash_algorithm_t algorithm,
+        const bool hmac,
+        const uint32_t key_len)
 {
+    // keep the context of the other stream
+    if ((active_ctx != NULL) && (active_ctx != ctx))
+    {
+        hal5_hash_suspend(active_ctx);
+    }
+
     const uint32_t encoded_algorithm = get_algorithm_encoding(algorithm);
 
     // select algorithm
@@ -147,14 +223,21 @@ void hal5_hash_init_for_hash(
             HASH_CR_INIT_Msk,
             1 << HASH_CR_INIT_Pos);
 
-    block_size = (((HASH->SR & HASH_SR_NBWE_Msk) >> HASH_SR_NBWE_Pos) - 1) * 4;
-    max_word_index = block_size >> 2;
+    ctx->algorithm = algorithm;
+    ctx->block_size = (((HASH->SR & HASH_SR_NBWE_Msk) >> HASH_SR_NBWE_Pos) - 1) * 4;
+    ctx->max_word_index = ctx->block_size >> 2;
 
-    // select hash mode
+    // select hash or hmac mode
     MODIFY_REG(
             HASH->CR,
             HASH_CR_MODE_Msk,
-            0 << HASH_CR_MODE_Pos);
+            (hmac ? 1 : 0) << HASH_CR_MODE_Pos);
+
+    // key longer than block size is hashed first
+    MODIFY_REG(
+            HASH->CR,
+            HASH_CR_LKEY_Msk,
+            ((key_len > ctx->block_size) ? 1 : 0) << HASH_CR_LKEY_Pos);
 
     // select data swapping, use DIN as 4x 8-bit data or bytes
     MODIFY_REG(
@@ -168,12 +251,36 @@ void hal5_hash_init_for_hash(
             HASH_CR_INIT_Msk,
             1 << HASH_CR_INIT_Pos);
 
-    nblw = 0;
+    start_phase(ctx);
+
+    ctx->partial_word = 0;
+    ctx->partial_len = 0;
 
-    word_index = 0;
+    ctx->completed = true;
+    ctx->suspended = false;
+
+    ctx->hmac = hmac;
+    ctx->key = NULL;
+    ctx->key_len = 0;
+
+    active_ctx = ctx;
+}
+
+void hal5_hash_init_for_hash(
+        hal5_hash_ctx_t* ctx,
+        const hal5_hash_algorithm_t algorithm)
+{
+    init(ctx, algorithm, false, 0);
 }
 
+static void write_words(
+        hal5_hash_ctx_t* ctx,
+        const uint32_t* words,
+        uint32_t nwords,
+        const bool aligned);
+
 void hal5_hash_update(
+        hal5_hash_ctx_t* ctx,
         const uint8_t* data, 
         const uint32_t offset,
         const uint32_t len)
@@ -183,14 +290,10 @@ void hal5_hash_update(
     if (word_size > 4) word_size = 4;
     if (word_size == 0) return;
 
-    // if this is the first word if the block
-    // wait for previous block processing to finish
-    if (word_index == 0)
-    {
-        while ((HASH->SR & HASH_SR_DINIS_Msk) == 0);
-    }
+    hal5_hash_resume(ctx);
 
     uint32_t din = 0UL;
+    uint32_t nblw = 0UL;
 
     if (word_size == 4UL)
     {
@@ -223,50 +326,702 @@ void hal5_hash_update(
         nblw = 8UL;
     }
 
-    HASH->DIN = din;
+    write_words(ctx, &din, 1, true);
 
-    word_index++;
-    if (word_index == max_word_index) word_index = 0;
+    ctx->nblw = nblw;
 }
 
-void hal5_hash_finalize(void)
+// copies only the digest size of HR registers to out
+// HR registers are big-endian, REV gives the bytes in memory order
+// all digest sizes are multiple of 4
+static void copy_digest(
+        const hal5_hash_algorithm_t algorithm,
+        uint8_t* out)
 {
+    const uint32_t nwords = hal5_hash_get_digest_size(algorithm) >> 2;
+
+    if ((((uint32_t) out) & 0x3) == 0)
+    {
+        uint32_t* out_words = (uint32_t*) out;
+
+        for (uint32_t i = 0; i < nwords; i++)
+        {
+            out_words[i] = __REV(HASH_DIGEST->HR[i]);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < nwords; i++)
+        {
+            __UNALIGNED_UINT32_WRITE(out + (i << 2), 
+                    __REV(HASH_DIGEST->HR[i]));
+        }
+    }
+}
+
+static void read_digest(
+        hal5_hash_ctx_t* ctx)
+{
+    copy_digest(ctx->algorithm, ctx->digest);
+}
+
+static void write_din(
+        const uint32_t* words,
+        uint32_t n,
+        const bool aligned)
+{
+    if (aligned)
+    {
+        while (n > 0)
+        {
+            HASH->DIN = *words++;
+            n--;
+        }
+    }
+    else
+    {
+        while (n > 0)
+        {
+            HASH->DIN = __UNALIGNED_UINT32_READ(words);
+            words++;
+            n--;
+        }
+    }
+}
+
+// writes one group of ctx->expected words to DIN
+static void write_group(
+        hal5_hash_ctx_t* ctx,
+        const uint32_t* words,
+        const bool aligned)
+{
+    while ((HASH->SR & HASH_SR_DINIS_Msk) == 0);
+
+    write_din(words, ctx->expected, aligned);
+
+    ctx->expected = ctx->max_word_index;
+}
+
+static void add_pending(
+        hal5_hash_ctx_t* ctx,
+        const uint32_t* words,
+        const uint32_t n,
+        const bool aligned)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        ctx->pending[ctx->npending++] = 
+            aligned ? words[i] : __UNALIGNED_UINT32_READ(&words[i]);
+    }
+}
+
+// writes nwords full words
+// DIN is written only in groups of NBWE words (ctx->expected), the rest
+// is kept in ctx->pending until the group is complete, so HASH is
+// always at a block boundary when this returns and can be suspended
+static void write_words(
+        hal5_hash_ctx_t* ctx,
+        const uint32_t* words,
+        uint32_t nwords,
+        const bool aligned)
+{
+    // complete the pending group first
+    if (ctx->npending > 0)
+    {
+        uint32_t n = ctx->expected - ctx->npending;
+        if (n > nwords) n = nwords;
+
+        add_pending(ctx, words, n, aligned);
+
+        words += n;
+        nwords -= n;
+
+        if (ctx->npending == ctx->expected)
+        {
+            write_group(ctx, ctx->pending, true);
+            ctx->npending = 0;
+        }
+    }
+
+    while (nwords >= ctx->expected)
+    {
+        const uint32_t n = ctx->expected;
+
+        write_group(ctx, words, aligned);
+
+        words += n;
+        nwords -= n;
+    }
+
+    add_pending(ctx, words, nwords, aligned);
+
+    ctx->nblw = 0UL;
+}
+
+// writes the pending words, less than a group so they fit to the FIFO
+// only before the digest calculation or DMA, HASH is not at a block
+// boundary anymore
+static void write_pending(
+        hal5_hash_ctx_t* ctx)
+{
+    if (ctx->npending == 0) return;
+
+    while ((HASH->SR & HASH_SR_DINIS_Msk) == 0);
+
+    write_din(ctx->pending, ctx->npending, true);
+
+    ctx->npending = 0;
+}
+
+static void write_partial_word(
+        hal5_hash_ctx_t* ctx)
+{
+    const uint32_t nblw = ctx->partial_len << 3;
+
+    write_words(ctx, &ctx->partial_word, 1, true);
+
+    ctx->nblw = nblw;
+
+    ctx->partial_word = 0;
+    ctx->partial_len = 0;
+}
+
+void hal5_hash_update_buffer(
+        hal5_hash_ctx_t* ctx,
+        const uint8_t* data,
+        uint32_t len)
+{
+    hal5_hash_resume(ctx);
+
+    // complete the partial word left from the previous call
+    while ((ctx->partial_len > 0) && (len > 0))
+    {
+        ctx->partial_word |= ((uint32_t) *data) << (ctx->partial_len << 3);
+        ctx->partial_len++;
+        data++;
+        len--;
+
+        if (ctx->partial_len == 4)
+        {
+            write_words(ctx, &ctx->partial_word, 1, true);
+            ctx->partial_word = 0;
+            ctx->partial_len = 0;
+        }
+    }
+
+    // DATATYPE is bytes, so a little-endian word load gives DIN
+    // the same value hal5_hash_update assembles byte by byte
+    const uint32_t nwords = len >> 2;
+
+    if (nwords > 0)
+    {
+        write_words(
+                ctx,
+                (const uint32_t*) data,
+                nwords,
+                (((uint32_t) data) & 0x3) == 0);
+
+        data += (nwords << 2);
+        len -= (nwords << 2);
+    }
+
+    // keep the tail, more data might follow
+    while (len > 0)
+    {
+        ctx->partial_word |= ((uint32_t) *data) << (ctx->partial_len << 3);
+        ctx->partial_len++;
+        data++;
+        len--;
+    }
+}
+
+// ends the current phase, the message or one of the hmac key phases
+static void end_phase(
+        hal5_hash_ctx_t* ctx)
+{
+    // flush the tail of hal5_hash_update_buffer
+    if (ctx->partial_len > 0) write_partial_word(ctx);
+
+    write_pending(ctx);
+
     // configure last word padding
     MODIFY_REG(
             HASH->STR,
             HASH_STR_NBLW_Msk,
-            nblw << HASH_STR_NBLW_Pos);
+            ctx->nblw << HASH_STR_NBLW_Pos);
 
     // start digest calculation
     MODIFY_REG(
             HASH->STR,
             HASH_STR_DCAL_Msk,
             1 << HASH_STR_DCAL_Pos);
+
+    // hmac has another phase after this
+    start_phase(ctx);
+}
+
+// waits until an hmac phase other than the last one is processed
+static void wait_hmac_phase(void)
+{
+    while ((HASH->SR & HASH_SR_DINIS_Msk) == 0);
+    while (HASH->SR & HASH_SR_BUSY);
+}
+
+void hal5_hash_init_for_hmac(
+        hal5_hash_ctx_t* key_ctx,
+        const hal5_hash_algorithm_t algorithm,
+        const uint8_t* key,
+        const uint32_t key_len)
+{
+    init(key_ctx, algorithm, true, key_len);
+
+    key_ctx->key = key;
+    key_ctx->key_len = key_len;
+
+    // inner key phase
+    hal5_hash_update_buffer(key_ctx, key, key_len);
+    end_phase(key_ctx);
+    wait_hmac_phase();
+
+    // this is the cached state, restored for each message
+    hal5_hash_suspend(key_ctx);
+}
+
+void hal5_hash_start_hmac(
+        hal5_hash_ctx_t* ctx,
+        const hal5_hash_ctx_t* key_ctx)
+{
+    assert (key_ctx->hmac);
+    assert (key_ctx->suspended);
+
+    // whatever ctx had in the peripheral is discarded
+    if (active_ctx == ctx) active_ctx = NULL;
+
+    // ctx is now a suspended stream right after the inner key phase
+    *ctx = *key_ctx;
+}
+
+// runs the last phase(s), digest is in HR registers when returns
+static void calculate_digest(
+        hal5_hash_ctx_t* ctx)
+{
+    hal5_hash_resume(ctx);
+
+    end_phase(ctx);
+
+    if (ctx->hmac)
+    {
+        wait_hmac_phase();
+
+        // outer key phase
+        hal5_hash_update_buffer(ctx, ctx->key, ctx->key_len);
+        end_phase(ctx);
+    }
     
     // wait for digest calculation completion
     while ((HASH->SR & HASH_SR_DCIS_Msk) == 0);
 
-    // copy all digest registers
-    // caller will know the digest size
-    for (uint32_t i = 0; i < 16; i++)
+    // nothing to save anymore
+    active_ctx = NULL;
+}
+
+void hal5_hash_finalize(
+        hal5_hash_ctx_t* ctx)
+{
+    calculate_digest(ctx);
+
+    read_digest(ctx);
+}
+
+void hal5_hash_finalize_to(
+        hal5_hash_ctx_t* ctx,
+        uint8_t* out)
+{
+    calculate_digest(ctx);
+
+    copy_digest(ctx->algorithm, out);
+}
+
+bool hal5_hash_finalize_and_compare(
+        hal5_hash_ctx_t* ctx,
+        const uint8_t* expected,
+        const uint32_t len)
+{
+    assert (len <= hal5_hash_get_digest_size(ctx->algorithm));
+
+    calculate_digest(ctx);
+
+    // constant time, all words are compared whatever the result is
+    uint32_t diff = 0;
+
+    const uint32_t nwords = len >> 2;
+
+    for (uint32_t i = 0; i < nwords; i++)
+    {
+        diff |= __REV(HASH_DIGEST->HR[i]) ^ 
+            __UNALIGNED_UINT32_READ(expected + (i << 2));
+    }
+
+    // truncated mac, compare the remaining bytes of the last word
+    const uint32_t rem = len & 0x3;
+
+    if (rem > 0)
+    {
+        const uint32_t d = HASH_DIGEST->HR[nwords];
+
+        for (uint32_t i = 0; i < rem; i++)
+        {
+            diff |= ((d >> (24 - (i << 3))) & 0xFF) ^ 
+                expected[(nwords << 2) + i];
+        }
+    }
+
+    return (diff == 0);
+}
+
+void hal5_hash_batch_sequential(
+        const hal5_hash_algorithm_t algorithm,
+        const hal5_hash_job_t* jobs,
+        const uint32_t njobs)
+{
+    if (njobs == 0) return;
+
+    hal5_hash_ctx_t ctx;
+
+    // full initialization only for the first job
+    hal5_hash_init_for_hash(&ctx, algorithm);
+
+    // ALGO, MODE and DATATYPE are same for all jobs
+    const uint32_t cr = HASH->CR;
+
+    const hal5_hash_job_t* job = &jobs[0];
+
+    for (uint32_t i = 0; i < njobs; i++)
+    {
+        hal5_hash_update_buffer(&ctx, job->data, job->len);
+
+        // NBLW and DCAL
+        end_phase(&ctx);
+
+        // while the digest is calculated, move to the next job
+        uint8_t* digest = job->digest;
+        const bool last = (i == (njobs - 1));
+
+        if (!last) job++;
+
+        while ((HASH->SR & HASH_SR_DCIS_Msk) == 0);
+
+        copy_digest(algorithm, digest);
+
+        if (!last)
+        {
+            // INIT resets the digest registers, so it can only be set
+            // after the digest is read, one write instead of init
+            HASH->CR = cr | HASH_CR_INIT;
+        }
+    }
+
+    // nothing to save anymore
+    active_ctx = NULL;
+}
+
+uint8_t* hal5_hash_get_digest(
+        hal5_hash_ctx_t* ctx)
+{
+    return ctx->digest;
+}
+
+// DMA transfer size (BNDT) is 16-bit, longer buffers are split
+#define HASH_DMA_MAX_CHUNK (0xFFFF & ~0x3UL)
+
+// ctx and callback of the running DMA or interrupt driven hashing
+static hal5_hash_ctx_t* async_ctx;
+static void (*async_callback)(void);
+
+static const hal5_hash_buffer_t* dma_buffers;
+static uint32_t dma_nbuffers;
+static uint32_t dma_buffer_index;
+static uint32_t dma_buffer_offset;
+// last partial word of the last buffer, written by the CPU
+// DMA transfers whole words, it would read past the end of the buffer
+static uint32_t dma_tail;
+static uint32_t dma_tail_len;
+static bool dma_cpu_end;
+
+static void dma_start_next(void);
+
+// writes the last partial word and starts the digest calculation
+static void dma_end(void)
+{
+    if (dma_tail_len > 0) HASH->DIN = dma_tail;
+
+    MODIFY_REG(
+            HASH->STR,
+            HASH_STR_NBLW_Msk,
+            (dma_tail_len << 3) << HASH_STR_NBLW_Pos);
+
+    SET_BIT(HASH->STR, HASH_STR_DCAL);
+}
+
+static void dma_transfer_completed(const bool error)
+{
+    assert (!error);
+
+    // last chunk of the last buffer is transferred
+    // HASH starts digest calculation itself (MDMAT is 0), or it is
+    // started after the last partial word, DCIE signals its end
+    if (dma_buffer_index == dma_nbuffers)
+    {
+        if (dma_cpu_end) dma_end();
+        return;
+    }
+
+    dma_start_next();
+}
+
+static void dma_start_next(void)
+{
+    // skip empty buffers except the last one
+    while ((dma_buffer_index < (dma_nbuffers - 1)) &&
+            (dma_buffers[dma_buffer_index].len == 0))
     {
-        const uint32_t d = HASH_DIGEST->HR[i];
+        dma_buffer_index++;
+    }
 
-        digest[i*4]     = (d >> 24) & 0xFF; 
-        digest[i*4+1]   = (d >> 16) & 0xFF; 
-        digest[i*4+2]   = (d >> 8) & 0xFF; 
-        digest[i*4+3]   = d & 0xFF; 
+    const hal5_hash_buffer_t* buffer = &dma_buffers[dma_buffer_index];
+
+    uint32_t len = buffer->len - dma_buffer_offset;
+    if (len > HASH_DMA_MAX_CHUNK) len = HASH_DMA_MAX_CHUNK;
+
+    const uint8_t* data = buffer->data + dma_buffer_offset;
+
+    dma_buffer_offset += len;
+    if (dma_buffer_offset == buffer->len)
+    {
+        dma_buffer_index++;
+        dma_buffer_offset = 0;
     }
+
+    const bool last = (dma_buffer_index == dma_nbuffers);
+
+    if (last)
+    {
+        SET_BIT(HASH->IMR, HASH_IMR_DCIE);
+
+        // DATATYPE is bytes, little-endian as a word load
+        dma_tail_len = len & 0x3;
+        len = len & ~0x3UL;
+
+        dma_tail = 0;
+        for (uint32_t i = 0; i < dma_tail_len; i++)
+        {
+            dma_tail |= ((uint32_t) data[len + i]) << (i << 3);
+        }
+
+        // nothing to transfer, i.e. empty message or only a partial word
+        if (len == 0)
+        {
+            dma_end();
+            return;
+        }
+
+        dma_cpu_end = (dma_tail_len > 0);
+
+        if (dma_cpu_end)
+        {
+            // CPU writes the last partial word after the DMA transfer
+            SET_BIT(HASH->CR, HASH_CR_MDMAT);
+        }
+        else
+        {
+            // digest calculation starts at the end of DMA transfer
+            CLEAR_BIT(HASH->STR, HASH_STR_NBLW_Msk);
+            CLEAR_BIT(HASH->CR, HASH_CR_MDMAT);
+        }
+    }
+    else
+    {
+        assert ((len & 0x3) == 0);
+        // more DMA transfers will follow
+        SET_BIT(HASH->CR, HASH_CR_MDMAT);
+    }
+
+    SET_BIT(HASH->CR, HASH_CR_DMAE);
+
+    hal5_dma_start(
+            hal5_dma_channel_hash,
+            hal5_dma_request_hash_in,
+            true,
+            &HASH->DIN,
+            data,
+            len,
+            hal5_dma_width_word,
+            dma_transfer_completed);
 }
 
-uint8_t* hal5_hash_get_digest()
+void hal5_hash_start_dma(
+        hal5_hash_ctx_t* ctx,
+        const hal5_hash_buffer_t* buffers,
+        const uint32_t nbuffers,
+        void (*callback)(void))
 {
-    return digest;
+    hal5_hash_resume(ctx);
+
+    assert (ctx->completed);
+    // only the message phase can be fed by DMA
+    assert (!ctx->hmac);
+    assert (nbuffers > 0);
+    // DMA cannot continue after a partial word written by the CPU
+    assert (ctx->partial_len == 0);
+    assert (ctx->nblw == 0);
+
+    for (uint32_t i = 0; i < nbuffers; i++)
+    {
+        assert ((((uint32_t) buffers[i].data) & 0x3) == 0);
+    }
+
+    // the words of an incomplete block, DMA continues after them
+    write_pending(ctx);
+
+    async_ctx = ctx;
+    dma_buffers = buffers;
+    dma_nbuffers = nbuffers;
+    dma_buffer_index = 0;
+    dma_buffer_offset = 0;
+    dma_cpu_end = false;
+    async_callback = callback;
+    ctx->completed = false;
+
+    NVIC_EnableIRQ(HASH_IRQn);
+
+    dma_start_next();
+}
+
+// remaining message of interrupt driven hashing
+static const uint8_t* it_data;
+static uint32_t it_len;
+
+// writes the next group of NBWE words, or starts the digest calculation
+static void it_write_block(void)
+{
+    hal5_hash_ctx_t* ctx = async_ctx;
+
+    const bool aligned = (((uint32_t) it_data) & 0x3) == 0;
+
+    if ((ctx->npending + (it_len >> 2)) >= ctx->expected)
+    {
+        // exactly one group, DINIS is set
+        const uint32_t nwords = ctx->expected - ctx->npending;
+
+        write_words(ctx, (const uint32_t*) it_data, nwords, aligned);
+
+        it_data += (nwords << 2);
+        it_len -= (nwords << 2);
+
+        // wait for DINIS for the next group or the rest
+        if (it_len > 0) return;
+    }
+
+    CLEAR_BIT(HASH->IMR, HASH_IMR_DINIE);
+
+    // the rest is less than a group
+    const uint32_t nwords = it_len >> 2;
+
+    write_words(ctx, (const uint32_t*) it_data, nwords, aligned);
+
+    it_data += (nwords << 2);
+    it_len -= (nwords << 2);
+
+    // last partial word
+    while (it_len > 0)
+    {
+        ctx->partial_word |= ((uint32_t) *it_data) << (ctx->partial_len << 3);
+        ctx->partial_len++;
+        it_data++;
+        it_len--;
+    }
+
+    SET_BIT(HASH->IMR, HASH_IMR_DCIE);
+
+    end_phase(ctx);
+}
+
+void hal5_hash_start_it(
+        hal5_hash_ctx_t* ctx,
+        const uint8_t* data,
+        const uint32_t len,
+        void (*callback)(void))
+{
+    hal5_hash_resume(ctx);
+
+    assert (ctx->completed);
+    // only the message phase can be fed by interrupts
+    assert (!ctx->hmac);
+    // cannot continue after a partial word written before
+    assert (ctx->partial_len == 0);
+    assert (ctx->nblw == 0);
+
+    async_ctx = ctx;
+    async_callback = callback;
+    it_data = data;
+    it_len = len;
+    ctx->completed = false;
+
+    NVIC_EnableIRQ(HASH_IRQn);
+
+    // HASH is at a block boundary, DINIS is set when it can take
+    // the next group, pending words are written with the first one
+    SET_BIT(HASH->IMR, HASH_IMR_DINIE);
+}
+
+bool hal5_hash_is_completed(
+        hal5_hash_ctx_t* ctx)
+{
+    return ctx->completed;
+}
+
+void hal5_hash_wait(
+        hal5_hash_ctx_t* ctx)
+{
+    // an interrupt pending wakes up WFI even if interrupts are disabled
+    // so the completion cannot be missed between the check and WFI
+    __disable_irq();
+    while (!ctx->completed)
+    {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+}
+
+void HASH_IRQHandler(void)
+{
+    if ((HASH->IMR & HASH_IMR_DINIE) && (HASH->SR & HASH_SR_DINIS))
+    {
+        it_write_block();
+    }
+
+    if ((HASH->IMR & HASH_IMR_DCIE) && (HASH->SR & HASH_SR_DCIS))
+    {
+        CLEAR_BIT(HASH->IMR, HASH_IMR_DCIE);
+        CLEAR_BIT(HASH->CR, HASH_CR_DMAE);
+
+        read_digest(async_ctx);
+
+        // nothing to save anymore
+        active_ctx = NULL;
+
+        async_ctx->completed = true;
+
+        if (async_callback != NULL) async_callback();
+    }
 }
 
 #if defined(HAL5_CAVP_SHA1_TESTS) || \
     defined(HAL5_CAVP_SHA256_TESTS) || \
-    defined(HAL5_CAVP_SHA512_TESTS)
+    defined(HAL5_CAVP_SHA512_TESTS) || \
+    defined(HAL5_CAVP_HMAC_TESTS)
 
 #if defined(HAL5_CAVP_SHA1_TESTS)
 
@@ -394,16 +1149,18 @@ void cavp_hash_test(
         uint8_t correct_digest[64];
         hexstr2bytes(expected, correct_digest, 64);
 
-        hal5_hash_init_for_hash(algorithm);
+        hal5_hash_ctx_t ctx;
+
+        hal5_hash_init_for_hash(&ctx, algorithm);
 
         for (uint32_t i = 0; i < input_len; i += 4)
         {
-            hal5_hash_update(input_buf, i, input_len);
+            hal5_hash_update(&ctx, input_buf, i, input_len);
         }
 
-        hal5_hash_finalize();
+        hal5_hash_finalize(&ctx);
 
-        uint8_t* calculated_digest = hal5_hash_get_digest();
+        uint8_t* calculated_digest = hal5_hash_get_digest(&ctx);
 
         if (cmpbytes(
                     calculated_digest, 
@@ -428,6 +1185,159 @@ void cavp_hash_test(
 }
 
 #endif
+
+#if defined(HAL5_CAVP_HMAC_TESTS)
+
+#include "cavp-test-vectors/HMAC.rsp.h"
+
+// rsp is a list of key, msg, mac triples terminated by NULL
+// mac can be shorter than the digest (Tlen)
+void cavp_hmac_test(
+        hal5_hash_algorithm_t algorithm, 
+        const char** rsp)
+{
+    while (*rsp != NULL)
+    {
+        const char* key = *rsp;
+        uint32_t key_len = strlen(key)/2;
+        rsp++;
+
+        const char* msg = *rsp;
+        uint32_t msg_len = strlen(msg)/2;
+        rsp++;
+
+        const char* expected = *rsp;
+        uint32_t mac_len = strlen(expected)/2;
+        rsp++;
+
+        uint8_t* key_buf = (uint8_t*) malloc(key_len);
+        hexstr2bytes(key, key_buf, key_len);
+
+        uint8_t* msg_buf = (uint8_t*) malloc(msg_len);
+        hexstr2bytes(msg, msg_buf, msg_len);
+
+        uint8_t correct_mac[64];
+        hexstr2bytes(expected, correct_mac, 64);
+
+        // use the cached key state like the applications do
+        hal5_hash_ctx_t key_ctx;
+        hal5_hash_ctx_t ctx;
+
+        hal5_hash_init_for_hmac(&key_ctx, algorithm, key_buf, key_len);
+
+        hal5_hash_start_hmac(&ctx, &key_ctx);
+
+        hal5_hash_update_buffer(&ctx, msg_buf, msg_len);
+
+        hal5_hash_finalize(&ctx);
+
+        uint8_t* calculated_mac = hal5_hash_get_digest(&ctx);
+
+        if (cmpbytes(calculated_mac, correct_mac, mac_len))
+        {
+            printf(".");
+            fflush(stdout);
+        }
+        else 
+        {
+            printf("Klen:%lu Tlen:%lu test failed\n", key_len, mac_len);
+            print_bytes("cor_mac: ", correct_mac, mac_len);
+            print_bytes("cal_mac: ", calculated_mac, mac_len);
+
+            assert (false);
+        }
+
+        free(msg_buf);
+        free(key_buf);
+    }
+    printf("\n");
+}
+
+#endif
+
+#if defined(HAL5_CAVP_BIN_TESTS)
+
+// generated by cavp2bin.py, see Makefile
+#include "cavp-test-vectors/SHA1ShortMsg.rsp.bin.h"
+#include "cavp-test-vectors/SHA1LongMsg.rsp.bin.h"
+#include "cavp-test-vectors/SHA256ShortMsg.rsp.bin.h"
+#include "cavp-test-vectors/SHA256LongMsg.rsp.bin.h"
+#include "cavp-test-vectors/SHA512ShortMsg.rsp.bin.h"
+#include "cavp-test-vectors/SHA512LongMsg.rsp.bin.h"
+
+// hal5_hash_cavp_run backend, the HASH peripheral
+static hal5_hash_ctx_t cavp_ctx;
+
+static void cavp_init(
+        const hal5_hash_algorithm_t algorithm)
+{
+    hal5_hash_init_for_hash(&cavp_ctx, algorithm);
+}
+
+static void cavp_update(
+        const uint8_t* data,
+        const uint32_t len)
+{
+    hal5_hash_update_buffer(&cavp_ctx, data, len);
+}
+
+static bool cavp_finalize_and_compare(
+        const uint8_t* expected,
+        const uint32_t len)
+{
+    return hal5_hash_finalize_and_compare(&cavp_ctx, expected, len);
+}
+
+static const hal5_hash_backend_t cavp_backend = {
+    .init = cavp_init,
+    .update = cavp_update,
+    .finalize_and_compare = cavp_finalize_and_compare,
+};
+
+// runs all records in a cavp2bin.py table
+// no parsing and no heap allocation, messages are hashed in place
+// returns the number of failed vectors
+uint32_t cavp_hash_run(
+        const char* name,
+        hal5_hash_algorithm_t algorithm, 
+        const uint8_t* table,
+        const uint32_t table_len)
+{
+    uint32_t passed = 0;
+    uint64_t bytes = 0;
+
+    hal5_enable_cycle_counter();
+
+    // the cycles include the table walk, it is small compared to hashing
+    const uint32_t start = DWT->CYCCNT;
+
+    const uint32_t failed = hal5_hash_cavp_run(
+            &cavp_backend,
+            algorithm,
+            hal5_hash_get_digest_size(algorithm),
+            table,
+            table_len,
+            &passed,
+            &bytes);
+
+    const uint64_t cycles = DWT->CYCCNT - start;
+
+    // bytes per microsecond is MB/s
+    const uint32_t mhz = hal5_rcc_get_sys_ck() / 1000000;
+    const uint32_t mbps100 = (cycles == 0) ? 0 : 
+        (uint32_t) ((bytes * mhz * 100) / cycles);
+
+    printf("%s passed=%lu failed=%lu MB/s=%lu.%02lu\n",
+            name, passed, failed, mbps100 / 100, mbps100 % 100);
+
+    return failed;
+}
+
+#define CAVP_HASH_RUN(algorithm, table) \
+    cavp_hash_run(#table, algorithm, table, sizeof(table))
+
+#endif
+
        
 void hal5_hash_test()
 {
@@ -470,5 +1380,54 @@ void hal5_hash_test()
             hal5_hash_sha2_512, 
             cavp_test_vectors_sha512longmsg_rsp);
 #endif
+#ifdef HAL5_CAVP_BIN_TESTS
+    uint32_t failed = 0;
+
+    failed += CAVP_HASH_RUN(hal5_hash_sha1, 
+            cavp_test_vectors_sha1shortmsg_rsp_bin);
+    failed += CAVP_HASH_RUN(hal5_hash_sha1, 
+            cavp_test_vectors_sha1longmsg_rsp_bin);
+    failed += CAVP_HASH_RUN(hal5_hash_sha2_256, 
+            cavp_test_vectors_sha256shortmsg_rsp_bin);
+    failed += CAVP_HASH_RUN(hal5_hash_sha2_256, 
+            cavp_test_vectors_sha256longmsg_rsp_bin);
+    failed += CAVP_HASH_RUN(hal5_hash_sha2_512, 
+            cavp_test_vectors_sha512shortmsg_rsp_bin);
+    failed += CAVP_HASH_RUN(hal5_hash_sha2_512, 
+            cavp_test_vectors_sha512longmsg_rsp_bin);
+
+    assert (failed == 0);
+#endif
+#ifdef HAL5_CAVP_HMAC_TESTS
+    printf("HMAC-SHA1 tests:\n");
+
+    cavp_hmac_test(
+            hal5_hash_sha1, 
+            cavp_test_vectors_hmac_sha1_rsp);
+
+    printf("HMAC-SHA224 tests:\n");
+
+    cavp_hmac_test(
+            hal5_hash_sha2_224, 
+            cavp_test_vectors_hmac_sha224_rsp);
+
+    printf("HMAC-SHA256 tests:\n");
+
+    cavp_hmac_test(
+            hal5_hash_sha2_256, 
+            cavp_test_vectors_hmac_sha256_rsp);
+
+    printf("HMAC-SHA384 tests:\n");
+
+    cavp_hmac_test(
+            hal5_hash_sha2_384, 
+            cavp_test_vectors_hmac_sha384_rsp);
+
+    printf("HMAC-SHA512 tests:\n");
+
+    cavp_hmac_test(
+            hal5_hash_sha2_512, 
+            cavp_test_vectors_hmac_sha512_rsp);
+#endif
 
 }
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// CAVP table walker, shared by cavp_hash_run in hal5_hash.c (HASH
+// peripheral) and host_test.c (software SHA), so the table layout
+// written by cavp2bin.py is checked on the host as well
+
+#include <assert.h>
+
+#include "hal5.h"
+
+uint32_t hal5_hash_cavp_run(
+        const hal5_hash_backend_t* backend,
+        const hal5_hash_algorithm_t algorithm,
+        const uint32_t digest_size,
+        const uint8_t* table,
+        const uint32_t table_len,
+        uint32_t* passed,
+        uint64_t* bytes)
+{
+    assert ((((uintptr_t) table) & 0x3) == 0);
+
+    uint32_t failed = 0;
+    uint32_t offset = 0;
+
+    while (offset < table_len)
+    {
+        const uint32_t msg_len = *((const uint32_t*) (table + offset));
+        offset += 4;
+
+        const uint8_t* msg = table + offset;
+        offset += (msg_len + 3) & ~0x3UL;
+
+        const uint8_t* expected = table + offset;
+        offset += digest_size;
+
+        // a truncated table cannot be walked further
+        assert (offset <= table_len);
+
+        backend->init(algorithm);
+        backend->update(msg, msg_len);
+
+        if (backend->finalize_and_compare(expected, digest_size))
+        {
+            (*passed)++;
+        }
+        else
+        {
+            failed++;
+        }
+
+        *bytes += msg_len;
+    }
+
+    return failed;
+}
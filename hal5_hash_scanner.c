@@ -0,0 +1,110 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <stm32h5xx.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// hashes a memory region slice by slice
+// it uses its own hash ctx, so other hashing can run between the steps
+
+static void start_pass(
+        hal5_hash_scanner_t* scanner)
+{
+    scanner->offset = 0;
+    hal5_hash_init_for_hash(&scanner->ctx, scanner->algorithm);
+}
+
+void hal5_hash_scanner_init(
+        hal5_hash_scanner_t* scanner,
+        const hal5_hash_algorithm_t algorithm,
+        const uint8_t* start,
+        const uint32_t len,
+        const uint32_t slice_size,
+        const uint8_t* reference,
+        void (*mismatch_callback)(hal5_hash_scanner_t* scanner))
+{
+    assert (slice_size > 0);
+
+    scanner->algorithm = algorithm;
+    scanner->start = start;
+    scanner->len = len;
+    scanner->slice_size = slice_size;
+    scanner->reference = reference;
+    scanner->mismatch_callback = mismatch_callback;
+    scanner->passes = 0;
+    scanner->mismatches = 0;
+    scanner->max_step_cycles = 0;
+
+    start_pass(scanner);
+}
+
+bool hal5_hash_scanner_step(
+        hal5_hash_scanner_t* scanner)
+{
+    // DWT CYCCNT is only counting if hal5_enable_cycle_counter is called
+    const uint32_t step_start = DWT->CYCCNT;
+
+    uint32_t len = scanner->len - scanner->offset;
+    if (len > scanner->slice_size) len = scanner->slice_size;
+
+    hal5_hash_update_buffer(
+            &scanner->ctx,
+            scanner->start + scanner->offset,
+            len);
+
+    scanner->offset += len;
+
+    bool pass_completed = false;
+    bool mismatch = false;
+
+    if (scanner->offset == scanner->len)
+    {
+        mismatch = !hal5_hash_finalize_and_compare(
+                &scanner->ctx,
+                scanner->reference,
+                hal5_hash_get_digest_size(scanner->algorithm));
+
+        scanner->passes++;
+        if (mismatch) scanner->mismatches++;
+
+        start_pass(scanner);
+
+        pass_completed = true;
+    }
+
+    // worst case includes the context switch, finalize and next init
+    const uint32_t cycles = DWT->CYCCNT - step_start;
+    if (cycles > scanner->max_step_cycles) 
+    {
+        scanner->max_step_cycles = cycles;
+    }
+
+    // callback is not included in the step latency
+    if (mismatch && (scanner->mismatch_callback != NULL))
+    {
+        scanner->mismatch_callback(scanner);
+    }
+
+    return pass_completed;
+}
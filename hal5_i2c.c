@@ -20,82 +20,140 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <stm32h5xx.h>
 
 #include "hal5.h"
 #include "hal5_private.h"
 
-static I2C_TypeDef* const i2c = I2C2;
+// registered by hal5_i2c_init for the interrupt handlers
+static hal5_i2c_t* instances[4] = {NULL, NULL, NULL, NULL};
 
-void hal5_i2c_configure()
-{
-    // I2C2 uses pclk1 by default
+static I2C_TypeDef* const i2c_regs[4] = {I2C1, I2C2, I2C3, I2C4};
 
-    // configure pins
-    // PF0 I2C2_SCL, PF0 I2C2_SDA with AF4
-    hal5_gpio_configure_as_af(
-            PF0,
-            af_od_floating,
-            high_speed,
-            AF4);
+// registers are not kept in hal5_i2c_t, so hal5_types.h has no device types
+#define REGS(i2c) (i2c_regs[(i2c)->n - 1])
 
-    hal5_gpio_configure_as_af(
-            PF1,
-            af_od_floating,
-            high_speed,
-            AF4);
+static const IRQn_Type ev_irqs[4] = {
+    I2C1_EV_IRQn, I2C2_EV_IRQn, I2C3_EV_IRQn, I2C4_EV_IRQn
+};
 
-    // enable I2C1 peripheral clock
-    SET_BIT(RCC->APB1LENR, RCC_APB1LENR_I2C2EN);
+static const IRQn_Type er_irqs[4] = {
+    I2C1_ER_IRQn, I2C2_ER_IRQn, I2C3_ER_IRQn, I2C4_ER_IRQn
+};
 
-    const uint32_t tscll    = 5000; // ns
-    const uint32_t tsclh    = 5000; // ns
-    const uint32_t tsdadel  = 1000; // ns
-    const uint32_t tscldel  = 1000; // ns
+void hal5_i2c_init(
+        hal5_i2c_t* i2c,
+        const uint32_t n,
+        const hal5_gpio_pin_t scl,
+        const hal5_gpio_pin_t sda,
+        const hal5_gpio_af_t af)
+{
+    assert (i2c != NULL);
+    assert (n > 0);
+    assert (n <= 4);
+    // one handle per instance
+    assert ((instances[n-1] == NULL) || (instances[n-1] == i2c));
 
-    const uint32_t presc = 15;
-    assert (presc <= 0xF);
+    memset(i2c, 0, sizeof(hal5_i2c_t));
 
-    const double tpresc = (1000000000.0 / (hal5_rcc_get_i2c_ker_ck(2) / (presc + 1))); // ns
+    i2c->n = n;
+    i2c->scl = scl;
+    i2c->sda = sda;
+    i2c->af = af;
 
-    const uint32_t scldel = tscldel / tpresc;
-    assert (scldel <= 0xF);
+    instances[n-1] = i2c;
+}
 
-    const uint32_t sdadel = tsdadel / tpresc;
-    assert (sdadel <= 0xF);
+// only PB6 to PB9 have a Fast-mode Plus drive control (SBS_PMCR)
+// other pins are used with the normal drive, the rise and fall times
+// given to hal5_i2c_configure have to take this into account
+static void enable_fmp(
+        const hal5_gpio_pin_t pin)
+{
+    uint32_t bit;
 
-    const uint32_t scll = (tscll / tpresc) - 1;
-    assert (scll <= 0xF);
+    switch ((uint32_t) pin)
+    {
+        case MAKE_GPIO_PIN('B', 6): bit = SBS_PMCR_PB6_FMP; break;
+        case MAKE_GPIO_PIN('B', 7): bit = SBS_PMCR_PB7_FMP; break;
+        case MAKE_GPIO_PIN('B', 8): bit = SBS_PMCR_PB8_FMP; break;
+        case MAKE_GPIO_PIN('B', 9): bit = SBS_PMCR_PB9_FMP; break;
+        default: return;
+    }
 
-    const uint32_t sclh = (tsclh / tpresc) - 1;
-    assert (sclh <= 0xF);
+    SET_BIT(RCC->APB3ENR, RCC_APB3ENR_SBSEN);
+    SET_BIT(SBS->PMCR, bit);
+}
 
-    MODIFY_REG(i2c->TIMINGR, I2C_TIMINGR_PRESC_Msk,
-            presc << I2C_TIMINGR_PRESC_Pos);
+void hal5_i2c_configure(
+        hal5_i2c_t* i2c,
+        const uint32_t speed,
+        const uint32_t rise_ns,
+        const uint32_t fall_ns)
+{
+    // I2C1 and I2C2 use pclk1, I2C3 and I2C4 use pclk3 by default
 
-    MODIFY_REG(i2c->TIMINGR, I2C_TIMINGR_SCLDEL_Msk,
-            scldel << I2C_TIMINGR_SCLDEL_Pos);
+    hal5_i2c_timing_t timing;
+    const bool found = hal5_i2c_calculate_timing(
+            hal5_rcc_get_i2c_ker_ck(i2c->n), 
+            speed, rise_ns, fall_ns, &timing);
+    assert (found);
 
-    MODIFY_REG(i2c->TIMINGR, I2C_TIMINGR_SDADEL_Msk,
-            sdadel << I2C_TIMINGR_SDADEL_Pos);
+    // configure pins
+    hal5_gpio_configure_as_af(
+            i2c->scl,
+            af_od_floating,
+            high_speed,
+            i2c->af);
 
-    MODIFY_REG(i2c->TIMINGR, I2C_TIMINGR_SCLH_Msk,
-            scll << I2C_TIMINGR_SCLH_Pos);
+    hal5_gpio_configure_as_af(
+            i2c->sda,
+            af_od_floating,
+            high_speed,
+            i2c->af);
 
-    MODIFY_REG(i2c->TIMINGR, I2C_TIMINGR_SCLL_Msk,
-            scll << I2C_TIMINGR_SCLL_Pos);
+    // Fast-mode Plus needs the 20 mA drive of the FT_f pins
+    if (speed > 400000)
+    {
+        enable_fmp(i2c->scl);
+        enable_fmp(i2c->sda);
+    }
+
+    // enable I2C peripheral clock
+    switch (i2c->n)
+    {
+        case 1: SET_BIT(RCC->APB1LENR, RCC_APB1LENR_I2C1EN); break;
+        case 2: SET_BIT(RCC->APB1LENR, RCC_APB1LENR_I2C2EN); break;
+        case 3: SET_BIT(RCC->APB3ENR, RCC_APB3ENR_I2C3EN); break;
+        case 4: SET_BIT(RCC->APB3ENR, RCC_APB3ENR_I2C4EN); break;
+        default: assert (false);
+    }
+
+    // TIMINGR can only be changed when I2C is disabled
+    CLEAR_BIT(REGS(i2c)->CR1, I2C_CR1_PE);
+
+    REGS(i2c)->TIMINGR = timing.timingr;
+    i2c->speed = timing.speed;
 
     // enable I2C
-    SET_BIT(i2c->CR1, I2C_CR1_PE);
+    SET_BIT(REGS(i2c)->CR1, I2C_CR1_PE);
+}
+
+uint32_t hal5_i2c_get_speed(
+        hal5_i2c_t* i2c)
+{
+    return i2c->speed;
 }
 
 bool hal5_i2c_read(
+        hal5_i2c_t* i2c,
         uint8_t* ch)
 {
     // anything in RXDR ?
-    if (i2c->ISR & I2C_ISR_RXNE_Msk) {
-        *ch = i2c->RXDR;
+    if (REGS(i2c)->ISR & I2C_ISR_RXNE_Msk) {
+        *ch = REGS(i2c)->RXDR;
         return true;
     } else {
         return false;
@@ -103,9 +161,819 @@ bool hal5_i2c_read(
 }
 
 void hal5_i2c_write(
+        hal5_i2c_t* i2c,
         const uint8_t ch)
 {
     // wait until TXDR is empty
-    while ((i2c->ISR & I2C_ISR_TXE_Msk) == 0);
-    i2c->TXDR = ch;
+    while ((REGS(i2c)->ISR & I2C_ISR_TXE_Msk) == 0);
+    REGS(i2c)->TXDR = ch;
+}
+
+// timeouts count hal5_ticks, they never expire without SysTick
+static void assert_systick()
+{
+    assert ((SysTick->CTRL & (SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk)) ==
+            (SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk));
+}
+
+// software reset, PE has to be low for 3 APB cycles
+static void reset(
+        I2C_TypeDef* const regs)
+{
+    CLEAR_BIT(regs->CR1, I2C_CR1_PE);
+    while (regs->CR1 & I2C_CR1_PE);
+    SET_BIT(regs->CR1, I2C_CR1_PE);
+}
+
+// a slave stopped in the middle of a byte can hold SDA low
+// SCL is clocked as GPIO until SDA is released (max. 9 clocks), then 
+// a STOP is generated (UM10204 3.1.16)
+// it is done in steps (recovery_step), so hal5_i2c_poll does not block
+
+// ODR is set before the pins become outputs, so they are not driven low
+// even for a moment, which could be seen as a START
+static void recovery_start(
+        hal5_i2c_t* i2c)
+{
+    hal5_gpio_set(i2c->sda);
+    hal5_gpio_configure_as_output(i2c->sda, output_od_floating, high_speed);
+    hal5_gpio_set(i2c->scl);
+    hal5_gpio_configure_as_output(i2c->scl, output_od_floating, high_speed);
+
+    i2c->recovery = hal5_i2c_recovery_released;
+    i2c->recovery_clocks = 0;
+    i2c->recovery_step_ticks = hal5_ticks;
+}
+
+// one SCL or SDA edge, returns true when the bus is cleared
+// and the pins are given back to I2C
+static bool recovery_step(
+        hal5_i2c_t* i2c)
+{
+    switch (i2c->recovery)
+    {
+        case hal5_i2c_recovery_released:
+        case hal5_i2c_recovery_scl_high:
+            hal5_gpio_reset(i2c->scl);
+            if (hal5_gpio_read(i2c->sda) || (i2c->recovery_clocks == 9))
+            {
+                i2c->recovery = hal5_i2c_recovery_stop_scl_low;
+            }
+            else
+            {
+                i2c->recovery_clocks++;
+                i2c->recovery = hal5_i2c_recovery_scl_low;
+            }
+            break;
+
+        case hal5_i2c_recovery_scl_low:
+            hal5_gpio_set(i2c->scl);
+            i2c->recovery = hal5_i2c_recovery_scl_high;
+            break;
+
+        case hal5_i2c_recovery_stop_scl_low:
+            hal5_gpio_reset(i2c->sda);
+            i2c->recovery = hal5_i2c_recovery_stop_sda_low;
+            break;
+
+        case hal5_i2c_recovery_stop_sda_low:
+            hal5_gpio_set(i2c->scl);
+            i2c->recovery = hal5_i2c_recovery_stop_scl_high;
+            break;
+
+        case hal5_i2c_recovery_stop_scl_high:
+            hal5_gpio_set(i2c->sda);
+            hal5_gpio_configure_as_af(
+                    i2c->scl, af_od_floating, high_speed, i2c->af);
+            hal5_gpio_configure_as_af(
+                    i2c->sda, af_od_floating, high_speed, i2c->af);
+            i2c->recovery = hal5_i2c_recovery_none;
+            return true;
+
+        default:
+            assert (false);
+    }
+
+    return false;
+}
+
+// blocking bus clear, used by the blocking functions
+// uses hal5_wait, so interrupts have to be enabled
+static void bus_clear(
+        hal5_i2c_t* i2c)
+{
+    recovery_start(i2c);
+
+    do
+    {
+        hal5_wait(1);
+    } while (!recovery_step(i2c));
+}
+
+// waits until one of the flags is set in ISR
+// returns an error if the transaction has failed meanwhile
+static hal5_i2c_status_t wait_flag(
+        hal5_i2c_t* i2c,
+        const uint32_t flag)
+{
+    I2C_TypeDef* const regs = REGS(i2c);
+
+    const uint32_t start = hal5_ticks;
+
+    while (true)
+    {
+        const uint32_t isr = regs->ISR;
+
+        if (isr & I2C_ISR_NACKF)
+        {
+            // master sends STOP automatically after NACK
+            while (((regs->ISR & I2C_ISR_STOPF) == 0) &&
+                    ((hal5_ticks - start) <= HAL5_I2C_TIMEOUT));
+            regs->ICR = I2C_ICR_NACKCF | I2C_ICR_STOPCF;
+            // discard the data waiting in TXDR
+            regs->ISR = I2C_ISR_TXE;
+            return hal5_i2c_nack;
+        }
+
+        if (isr & I2C_ISR_ARLO)
+        {
+            regs->ICR = I2C_ICR_ARLOCF;
+            return hal5_i2c_arbitration_lost;
+        }
+
+        if (isr & I2C_ISR_BERR)
+        {
+            regs->ICR = I2C_ICR_BERRCF;
+            return hal5_i2c_bus_error;
+        }
+
+        if (isr & flag) return hal5_i2c_ok;
+
+        if ((hal5_ticks - start) > HAL5_I2C_TIMEOUT)
+        {
+            reset(regs);
+            bus_clear(i2c);
+            return hal5_i2c_timeout;
+        }
+    }
+}
+
+// NBYTES is 8-bit, RELOAD continues the transfer with the next NBYTES
+// returns the number of bytes left for the next chunks
+static uint32_t set_nbytes(
+        I2C_TypeDef* const regs,
+        const uint32_t remaining,
+        const bool stop)
+{
+    uint32_t cr2 = regs->CR2;
+
+    cr2 &= ~(I2C_CR2_NBYTES_Msk | I2C_CR2_RELOAD | I2C_CR2_AUTOEND);
+
+    if (remaining > 255)
+    {
+        cr2 |= (255 << I2C_CR2_NBYTES_Pos) | I2C_CR2_RELOAD;
+        regs->CR2 = cr2;
+        return remaining - 255;
+    }
+    else
+    {
+        cr2 |= (remaining << I2C_CR2_NBYTES_Pos);
+        if (stop) cr2 |= I2C_CR2_AUTOEND;
+        regs->CR2 = cr2;
+        return 0;
+    }
+}
+
+// starts a transfer with START (or repeated START)
+// returns the number of bytes left for the next chunks
+static uint32_t start(
+        I2C_TypeDef* const regs,
+        const uint8_t address,
+        const bool read,
+        const uint32_t len,
+        const bool stop)
+{
+    assert (address <= 0x7F);
+
+    uint32_t cr2 = (address << 1) << I2C_CR2_SADD_Pos;
+    if (read) cr2 |= I2C_CR2_RD_WRN;
+    regs->CR2 = cr2;
+
+    const uint32_t left = set_nbytes(regs, len, stop);
+
+    SET_BIT(regs->CR2, I2C_CR2_START);
+
+    return left;
+}
+
+// DMA is used only for larger transfers, BNDT is 16-bit
+static bool use_dma(
+        hal5_i2c_t* i2c,
+        const uint32_t len)
+{
+    return i2c->dma_enabled && 
+        (len >= HAL5_I2C_DMA_THRESHOLD) && 
+        (len <= 0xFFFF);
+}
+
+// each instance has its own pair of channels
+static hal5_dma_channel_t dma_channel(
+        hal5_i2c_t* i2c,
+        const bool read)
+{
+    return hal5_dma_channel_i2c1_tx + (2 * (i2c->n - 1)) + (read ? 1 : 0);
+}
+
+// has to be started before START, so the first TXIS is not missed
+// only the transfer error and the completion of DMA causes an interrupt
+static void dma_start(
+        hal5_i2c_t* i2c,
+        const bool read,
+        uint8_t* data,
+        const uint32_t len)
+{
+    const hal5_dma_request_t request = 
+        hal5_dma_request_i2c1_tx + (2 * (i2c->n - 1)) + (read ? 1 : 0);
+
+    if (read)
+    {
+        SET_BIT(REGS(i2c)->CR1, I2C_CR1_RXDMAEN);
+        hal5_dma_start(
+                dma_channel(i2c, true),
+                request,
+                false,
+                &REGS(i2c)->RXDR,
+                data,
+                len,
+                hal5_dma_width_byte,
+                NULL);
+    }
+    else
+    {
+        SET_BIT(REGS(i2c)->CR1, I2C_CR1_TXDMAEN);
+        hal5_dma_start(
+                dma_channel(i2c, false),
+                request,
+                true,
+                &REGS(i2c)->TXDR,
+                data,
+                len,
+                hal5_dma_width_byte,
+                NULL);
+    }
+}
+
+// completed, the last byte received can still be in transit to memory
+// otherwise, the transfer is aborted
+static void dma_stop(
+        hal5_i2c_t* i2c,
+        const bool completed)
+{
+    if (completed)
+    {
+        while (hal5_dma_is_busy(dma_channel(i2c, true)));
+    }
+
+    hal5_dma_abort(dma_channel(i2c, false));
+    hal5_dma_abort(dma_channel(i2c, true));
+
+    CLEAR_BIT(REGS(i2c)->CR1, I2C_CR1_TXDMAEN | I2C_CR1_RXDMAEN);
+}
+
+// same as transfer, data is moved by DMA, only the chunks are handled
+static hal5_i2c_status_t transfer_dma(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        const bool read,
+        uint8_t* data,
+        const uint32_t len,
+        const bool stop)
+{
+    I2C_TypeDef* const regs = REGS(i2c);
+
+    hal5_i2c_status_t status = hal5_i2c_ok;
+
+    dma_start(i2c, read, data, len);
+
+    uint32_t left = start(regs, address, read, len, stop);
+
+    while (left > 0)
+    {
+        status = wait_flag(i2c, I2C_ISR_TCR);
+        if (status != hal5_i2c_ok) break;
+
+        left = set_nbytes(regs, left, stop);
+    }
+
+    if (left == 0)
+    {
+        status = wait_flag(i2c, stop ? I2C_ISR_STOPF : I2C_ISR_TC);
+        if (stop && (status == hal5_i2c_ok)) regs->ICR = I2C_ICR_STOPCF;
+    }
+
+    dma_stop(i2c, status == hal5_i2c_ok);
+
+    return status;
+}
+
+// one transfer in one direction starting with START (or repeated START)
+// if stop is false, it ends when TC is set, so another transfer can
+// continue with a repeated START
+static hal5_i2c_status_t transfer(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        const bool read,
+        uint8_t* data,
+        const uint32_t len,
+        const bool stop)
+{
+    // queue uses the interrupts
+    assert (!i2c->queue_enabled);
+    assert_systick();
+
+    if (use_dma(i2c, len)) 
+    {
+        return transfer_dma(i2c, address, read, data, len, stop);
+    }
+
+    I2C_TypeDef* const regs = REGS(i2c);
+
+    hal5_i2c_status_t status;
+
+    start(regs, address, read, len, stop);
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        // a chunk of 255 bytes is completed, continue with the next one
+        if ((i > 0) && ((i % 255) == 0))
+        {
+            status = wait_flag(i2c, I2C_ISR_TCR);
+            if (status != hal5_i2c_ok) return status;
+
+            set_nbytes(regs, len - i, stop);
+        }
+
+        if (read)
+        {
+            status = wait_flag(i2c, I2C_ISR_RXNE);
+            if (status != hal5_i2c_ok) return status;
+
+            data[i] = regs->RXDR;
+        }
+        else
+        {
+            status = wait_flag(i2c, I2C_ISR_TXIS);
+            if (status != hal5_i2c_ok) return status;
+
+            regs->TXDR = data[i];
+        }
+    }
+
+    if (stop)
+    {
+        status = wait_flag(i2c, I2C_ISR_STOPF);
+        if (status != hal5_i2c_ok) return status;
+
+        regs->ICR = I2C_ICR_STOPCF;
+    }
+    else
+    {
+        status = wait_flag(i2c, I2C_ISR_TC);
+        if (status != hal5_i2c_ok) return status;
+    }
+
+    return hal5_i2c_ok;
+}
+
+hal5_i2c_status_t hal5_i2c_master_write(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        const uint8_t* data,
+        const uint32_t len)
+{
+    return transfer(i2c, address, false, (uint8_t*) data, len, true);
+}
+
+hal5_i2c_status_t hal5_i2c_master_read(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        uint8_t* data,
+        const uint32_t len)
+{
+    assert (len > 0);
+
+    return transfer(i2c, address, true, data, len, true);
+}
+
+hal5_i2c_status_t hal5_i2c_master_write_read(
+        hal5_i2c_t* i2c,
+        const uint8_t address,
+        const uint8_t* wdata,
+        const uint32_t wlen,
+        uint8_t* rdata,
+        const uint32_t rlen)
+{
+    assert (wlen > 0);
+    assert (rlen > 0);
+
+    const hal5_i2c_status_t status = 
+        transfer(i2c, address, false, (uint8_t*) wdata, wlen, false);
+
+    if (status != hal5_i2c_ok) return status;
+
+    return transfer(i2c, address, true, rdata, rlen, true);
+}
+
+static hal5_i2c_job_t* queue_active(
+        hal5_i2c_t* i2c)
+{
+    return i2c->queue[i2c->queue_tail & (HAL5_I2C_QUEUE_SIZE - 1)];
+}
+
+// starts the write or the read phase of the job
+static void queue_start_phase(
+        hal5_i2c_t* i2c,
+        hal5_i2c_job_t* job,
+        const bool read)
+{
+    const uint32_t len = read ? job->rx_len : job->tx_len;
+
+    i2c->job_reading = read;
+    i2c->job_index = 0;
+
+    if (use_dma(i2c, len))
+    {
+        // TXIS and RXNE generate DMA requests instead
+        CLEAR_BIT(REGS(i2c)->CR1, I2C_CR1_TXIE | I2C_CR1_RXIE);
+        dma_start(i2c, read, read ? job->rx : (uint8_t*) job->tx, len);
+    }
+    else
+    {
+        SET_BIT(REGS(i2c)->CR1, I2C_CR1_TXIE | I2C_CR1_RXIE);
+    }
+
+    i2c->job_nbytes_left = start(REGS(i2c), job->address, read, len, 
+            read || (job->rx_len == 0));
+}
+
+// the job at queue_tail is started, cancelled ones are skipped
+static void queue_start_next(
+        hal5_i2c_t* i2c)
+{
+    while (i2c->queue_head != i2c->queue_tail)
+    {
+        hal5_i2c_job_t* job = queue_active(i2c);
+
+        if (job->status == hal5_i2c_cancelled)
+        {
+            i2c->queue_tail = i2c->queue_tail + 1;
+            continue;
+        }
+
+        job->status = hal5_i2c_active;
+        i2c->job_started = hal5_ticks;
+
+        queue_start_phase(i2c, job, job->tx_len == 0);
+
+        return;
+    }
+}
+
+static void queue_complete(
+        hal5_i2c_t* i2c,
+        const hal5_i2c_status_t status)
+{
+    hal5_i2c_job_t* job = queue_active(i2c);
+
+    if (i2c->dma_enabled) dma_stop(i2c, status == hal5_i2c_ok);
+
+    job->status = status;
+    i2c->queue_tail = i2c->queue_tail + 1;
+
+    // next job is started first, so the callback can submit a new job
+    queue_start_next(i2c);
+
+    if (job->callback != NULL) job->callback(job);
+}
+
+static void ev_irq_handler(
+        hal5_i2c_t* i2c)
+{
+    if ((i2c == NULL) || (i2c->queue_head == i2c->queue_tail)) return;
+
+    I2C_TypeDef* const regs = REGS(i2c);
+
+    hal5_i2c_job_t* job = queue_active(i2c);
+
+    const uint32_t isr = regs->ISR;
+    const uint32_t cr1 = regs->CR1;
+
+    if (isr & I2C_ISR_NACKF)
+    {
+        regs->ICR = I2C_ICR_NACKCF;
+        // discard the data waiting in TXDR
+        regs->ISR = I2C_ISR_TXE;
+        // job is completed when STOP (sent automatically) is detected
+        job->status = hal5_i2c_nack;
+    }
+
+    // in a DMA phase, RXIE and TXIE are cleared and RXNE and TXIS are
+    // served by DMA, job_index is used only when they are set
+    if ((isr & I2C_ISR_RXNE) && (cr1 & I2C_CR1_RXIE))
+    {
+        assert (i2c->job_index < job->rx_len);
+        job->rx[i2c->job_index++] = regs->RXDR;
+    }
+
+    if ((isr & I2C_ISR_TXIS) && (cr1 & I2C_CR1_TXIE))
+    {
+        assert (i2c->job_index < job->tx_len);
+        regs->TXDR = job->tx[i2c->job_index++];
+    }
+
+    if (isr & I2C_ISR_TCR)
+    {
+        if (job->status == hal5_i2c_cancelled)
+        {
+            SET_BIT(regs->CR2, I2C_CR2_STOP);
+        }
+        else
+        {
+            // continue with the next chunk of max. 255 bytes
+            const bool stop = i2c->job_reading || (job->rx_len == 0);
+            i2c->job_nbytes_left = 
+                set_nbytes(regs, i2c->job_nbytes_left, stop);
+        }
+    }
+
+    if (isr & I2C_ISR_TC)
+    {
+        if (job->status == hal5_i2c_cancelled)
+        {
+            SET_BIT(regs->CR2, I2C_CR2_STOP);
+        }
+        else
+        {
+            // write phase is completed, read with a repeated START
+            if (i2c->dma_enabled) dma_stop(i2c, true);
+            queue_start_phase(i2c, job, true);
+        }
+    }
+
+    if (isr & I2C_ISR_STOPF)
+    {
+        regs->ICR = I2C_ICR_STOPCF;
+
+        queue_complete(i2c, (job->status == hal5_i2c_active) ?
+                hal5_i2c_ok : job->status);
+    }
+}
+
+static void er_irq_handler(
+        hal5_i2c_t* i2c)
+{
+    if (i2c == NULL) return;
+
+    I2C_TypeDef* const regs = REGS(i2c);
+
+    const uint32_t isr = regs->ISR;
+
+    hal5_i2c_status_t status = hal5_i2c_bus_error;
+
+    if (isr & I2C_ISR_ARLO) status = hal5_i2c_arbitration_lost;
+
+    regs->ICR = I2C_ICR_ARLOCF | I2C_ICR_BERRCF | I2C_ICR_OVRCF;
+
+    // bus is released, there is no STOP to wait for
+    if (i2c->queue_head != i2c->queue_tail) queue_complete(i2c, status);
+}
+
+// macro for I2C<N>_EV_IRQHandler and I2C<N>_ER_IRQHandler
+#define I2C_IRQHandlers(n) \
+    void I2C ## n ## _EV_IRQHandler(void) \
+    { \
+        ev_irq_handler(instances[n-1]); \
+    } \
+    void I2C ## n ## _ER_IRQHandler(void) \
+    { \
+        er_irq_handler(instances[n-1]); \
+    }
+
+I2C_IRQHandlers(1)
+I2C_IRQHandlers(2)
+I2C_IRQHandlers(3)
+I2C_IRQHandlers(4)
+
+void hal5_i2c_enable_queue(
+        hal5_i2c_t* i2c)
+{
+    // job deadlines depend on the bus speed
+    assert (i2c->speed > 0);
+    assert_systick();
+
+    // TXIE and RXIE are set per transfer, unless DMA is used
+    SET_BIT(REGS(i2c)->CR1, 
+            I2C_CR1_TCIE | I2C_CR1_STOPIE | I2C_CR1_NACKIE | I2C_CR1_ERRIE);
+
+    NVIC_EnableIRQ(ev_irqs[i2c->n - 1]);
+    NVIC_EnableIRQ(er_irqs[i2c->n - 1]);
+
+    i2c->queue_enabled = true;
+}
+
+void hal5_i2c_disable_queue(
+        hal5_i2c_t* i2c)
+{
+    assert (i2c->queue_head == i2c->queue_tail);
+
+    NVIC_DisableIRQ(ev_irqs[i2c->n - 1]);
+    NVIC_DisableIRQ(er_irqs[i2c->n - 1]);
+
+    CLEAR_BIT(REGS(i2c)->CR1, 
+            I2C_CR1_TXIE | I2C_CR1_RXIE | I2C_CR1_TCIE | 
+            I2C_CR1_STOPIE | I2C_CR1_NACKIE | I2C_CR1_ERRIE);
+
+    i2c->queue_enabled = false;
+}
+
+void hal5_i2c_enable_dma(
+        hal5_i2c_t* i2c)
+{
+    // only GPDMA1 is used and it has no channels left for I2C4
+    assert (i2c->n <= 3);
+
+    hal5_dma_enable();
+
+    i2c->dma_enabled = true;
+}
+
+void hal5_i2c_disable_dma(
+        hal5_i2c_t* i2c)
+{
+    assert (i2c->queue_head == i2c->queue_tail);
+
+    i2c->dma_enabled = false;
+}
+
+bool hal5_i2c_submit(
+        hal5_i2c_t* i2c,
+        hal5_i2c_job_t* job)
+{
+    assert (i2c->queue_enabled);
+    assert (job != NULL);
+    assert (job->address <= 0x7F);
+    assert ((job->tx_len > 0) || (job->rx_len > 0));
+
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((i2c->queue_head - i2c->queue_tail) == HAL5_I2C_QUEUE_SIZE)
+    {
+        __set_PRIMASK(primask);
+        return false;
+    }
+
+    job->status = hal5_i2c_pending;
+
+    i2c->queue[i2c->queue_head & (HAL5_I2C_QUEUE_SIZE - 1)] = job;
+    i2c->queue_head = i2c->queue_head + 1;
+
+    // queue was empty
+    if ((i2c->queue_head - i2c->queue_tail) == 1) queue_start_next(i2c);
+
+    __set_PRIMASK(primask);
+
+    return true;
+}
+
+bool hal5_i2c_cancel(
+        hal5_i2c_t* i2c,
+        hal5_i2c_job_t* job)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    bool cancelled = false;
+
+    if (job->status == hal5_i2c_pending)
+    {
+        // skipped when it is its turn
+        job->status = hal5_i2c_cancelled;
+        cancelled = true;
+    }
+    else if ((job->status == hal5_i2c_active) && 
+            (i2c->queue_head != i2c->queue_tail) &&
+            (queue_active(i2c) == job))
+    {
+        // STOP is sent after the current byte, so the slave is not left
+        // in the middle of a byte, job is completed when STOPF is set
+        // if STOP cannot be sent, hal5_i2c_poll resets the bus
+        job->status = hal5_i2c_cancelled;
+        // during bus clear, the job is completed by hal5_i2c_poll
+        if (i2c->recovery == hal5_i2c_recovery_none)
+        {
+            SET_BIT(REGS(i2c)->CR2, I2C_CR2_STOP);
+        }
+        cancelled = true;
+    }
+
+    __set_PRIMASK(primask);
+
+    return cancelled;
+}
+
+// ms the job is allowed to take
+static uint32_t job_deadline(
+        hal5_i2c_t* i2c,
+        hal5_i2c_job_t* job)
+{
+    if (job->timeout != 0) return job->timeout;
+
+    // 9 bits per byte, address bytes and rounding
+    const uint64_t bits = ((uint64_t) job->tx_len + job->rx_len + 3) * 9;
+
+    return HAL5_I2C_TIMEOUT + (uint32_t) ((bits * 1000) / i2c->speed);
+}
+
+void hal5_i2c_poll(
+        hal5_i2c_t* i2c)
+{
+    if (i2c->recovery != hal5_i2c_recovery_none)
+    {
+        // at most one step per ms
+        if (hal5_ticks == i2c->recovery_step_ticks) return;
+
+        i2c->recovery_step_ticks = hal5_ticks;
+
+        if (!recovery_step(i2c)) return;
+
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        hal5_i2c_job_t* job = queue_active(i2c);
+
+        queue_complete(i2c, (job->status == hal5_i2c_cancelled) ?
+                hal5_i2c_cancelled : hal5_i2c_timeout);
+
+        __set_PRIMASK(primask);
+
+        NVIC_EnableIRQ(ev_irqs[i2c->n - 1]);
+        NVIC_EnableIRQ(er_irqs[i2c->n - 1]);
+
+        return;
+    }
+
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (i2c->queue_head == i2c->queue_tail)
+    {
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    hal5_i2c_job_t* job = queue_active(i2c);
+
+    if ((hal5_ticks - i2c->job_started) <= job_deadline(i2c, job))
+    {
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    // job cannot be completed by the interrupt handlers until the bus
+    // is cleared, the job stays active meanwhile
+    NVIC_DisableIRQ(ev_irqs[i2c->n - 1]);
+    NVIC_DisableIRQ(er_irqs[i2c->n - 1]);
+
+    __set_PRIMASK(primask);
+
+    reset(REGS(i2c));
+    recovery_start(i2c);
+}
+
+uint32_t hal5_i2c_get_queue_length(
+        hal5_i2c_t* i2c)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t length = 0;
+
+    // the job at queue_tail is on the bus even if it is cancelled
+    // cancelled pending jobs are not counted, they are dropped when
+    // the active job completes
+    for (uint32_t i = i2c->queue_tail; i != i2c->queue_head; i++)
+    {
+        const hal5_i2c_job_t* job = 
+            i2c->queue[i & (HAL5_I2C_QUEUE_SIZE - 1)];
+
+        if ((i == i2c->queue_tail) || (job->status == hal5_i2c_pending))
+        {
+            length++;
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    return length;
 }
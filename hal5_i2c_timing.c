@@ -0,0 +1,399 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// TIMINGR calculation is kept separate from the register access
+// so it can also be compiled and tested on a PC (make host-test)
+// RM0481 I2C timings and I2C-bus specification (UM10204) Table 10
+// analog filter is assumed to be on (ANFOFF=0) and DNF=0
+
+// RM0481 I2C_TIMINGR fields, defined here to not need the device header
+#define TIMINGR_PRESC_Pos 28
+#define TIMINGR_SCLDEL_Pos 20
+#define TIMINGR_SDADEL_Pos 16
+#define TIMINGR_SCLH_Pos 8
+#define TIMINGR_SCLL_Pos 0
+
+// analog filter delay, ns
+#define TAF_MIN 50
+#define TAF_MAX 260
+
+// all in ns
+typedef struct
+{
+    uint32_t max_speed;
+    uint32_t tlow_min;
+    uint32_t thigh_min;
+    // max. data valid time
+    uint32_t tvddat_max;
+    uint32_t tsudat_min;
+    uint32_t tr_max;
+    uint32_t tf_max;
+} spec_t;
+
+static const spec_t specs[] = {
+    // Standard-mode
+    {100000, 4700, 4000, 3450, 250, 1000, 300},
+    // Fast-mode
+    {400000, 1300, 600, 900, 100, 300, 300},
+    // Fast-mode Plus
+    {1000000, 500, 260, 450, 50, 120, 120},
+};
+
+// ns to I2CCLK cycles, rounded up and down
+static int64_t ns_to_cycles_ceil(
+        const int64_t ns,
+        const uint32_t ker_ck)
+{
+    const int64_t v = ns * ker_ck;
+    if (v <= 0) return v / 1000000000;
+    return (v + 999999999) / 1000000000;
+}
+
+static int64_t ns_to_cycles_floor(
+        const int64_t ns,
+        const uint32_t ker_ck)
+{
+    const int64_t v = ns * ker_ck;
+    if (v >= 0) return v / 1000000000;
+    return -((-v + 999999999) / 1000000000);
+}
+
+// smallest n >= 0 with n * d >= v
+static int64_t div_ceil(
+        const int64_t v,
+        const int64_t d)
+{
+    if (v <= 0) return 0;
+    return (v + d - 1) / d;
+}
+
+// tSYNC1 + tSYNC2, I2CCLK cycles
+// tSYNC is the edge, the analog filter and 2 to 3 I2CCLK cycles
+// minimum is used, so the actual speed is never more than requested
+static int64_t sync_cycles(
+        const uint32_t ker_ck,
+        const uint32_t rise_ns,
+        const uint32_t fall_ns)
+{
+    return ns_to_cycles_floor(rise_ns + fall_ns + (2 * TAF_MIN), ker_ck) + 4;
+}
+
+bool hal5_i2c_calculate_timing(
+        const uint32_t ker_ck,
+        const uint32_t speed,
+        const uint32_t rise_ns,
+        const uint32_t fall_ns,
+        hal5_i2c_timing_t* timing)
+{
+    assert (timing != NULL);
+
+    if ((ker_ck == 0) || (speed == 0)) return false;
+
+    const spec_t* spec = NULL;
+
+    for (uint32_t i = 0; i < (sizeof(specs) / sizeof(spec_t)); i++)
+    {
+        if (speed <= specs[i].max_speed)
+        {
+            spec = &specs[i];
+            break;
+        }
+    }
+
+    if (spec == NULL) return false;
+    if ((rise_ns > spec->tr_max) || (fall_ns > spec->tf_max)) return false;
+
+    // tSCL = tSYNC1 + tSYNC2 + (SCLL + 1 + SCLH + 1) * tPRESC
+    const int64_t sync = sync_cycles(ker_ck, rise_ns, fall_ns);
+
+    // rounded up, I2CCLK cycles
+    const int64_t period = ((int64_t) ker_ck + speed - 1) / speed;
+
+    // tSCLDEL = (SCLDEL + 1) * tPRESC >= tr + tSU;DAT
+    const int64_t scldel_cycles = ns_to_cycles_ceil(
+            rise_ns + spec->tsudat_min, ker_ck);
+
+    // tSDADEL = SDADEL * tPRESC
+    // >= tf - tAF(min) - 3 * tI2CCLK
+    // <= tVD;DAT - tr - tAF(max) - 4 * tI2CCLK
+    const int64_t sdadel_min_cycles =
+        ns_to_cycles_ceil((int64_t) fall_ns - TAF_MIN, ker_ck) - 3;
+    const int64_t sdadel_max_cycles = ns_to_cycles_floor(
+            (int64_t) spec->tvddat_max - rise_ns - TAF_MAX, ker_ck) - 4;
+
+    const int64_t tlow_cycles = ns_to_cycles_ceil(spec->tlow_min, ker_ck);
+    const int64_t thigh_cycles = ns_to_cycles_ceil(spec->thigh_min, ker_ck);
+
+    bool found = false;
+    int64_t best_period = 0;
+
+    for (uint32_t presc = 0; presc <= 0xF; presc++)
+    {
+        const int64_t p = presc + 1;
+
+        int64_t scldel = div_ceil(scldel_cycles, p) - 1;
+        if (scldel < 0) scldel = 0;
+        if (scldel > 0xF) continue;
+
+        const int64_t sdadel = div_ceil(sdadel_min_cycles, p);
+        if (sdadel > 0xF) continue;
+        if ((sdadel * p) > sdadel_max_cycles) continue;
+
+        // data is changed and set up while SCL is low
+        int64_t low = div_ceil(tlow_cycles, p);
+        if (low < (sdadel + scldel + 2)) low = sdadel + scldel + 2;
+
+        int64_t high = div_ceil(thigh_cycles, p);
+        if (high < 1) high = 1;
+
+        // stretched to the requested period, low gets the odd one
+        const int64_t total = div_ceil(period - sync, p);
+        if ((low + high) < total)
+        {
+            const int64_t extra = total - (low + high);
+            high = high + (extra / 2);
+            low = low + extra - (extra / 2);
+        }
+
+        // SCLL and SCLH are 8-bit
+        if ((low > 256) || (high > 256)) continue;
+
+        const int64_t actual_period = ((low + high) * p) + sync;
+
+        // smaller prescaler is kept on equal period, it has finer steps
+        if (!found || (actual_period < best_period))
+        {
+            best_period = actual_period;
+            timing->presc = presc;
+            timing->scll = (uint32_t) (low - 1);
+            timing->sclh = (uint32_t) (high - 1);
+            timing->sdadel = (uint32_t) sdadel;
+            timing->scldel = (uint32_t) scldel;
+            timing->speed = (uint32_t) (ker_ck / actual_period);
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        timing->timingr =
+            (timing->presc << TIMINGR_PRESC_Pos) |
+            (timing->scldel << TIMINGR_SCLDEL_Pos) |
+            (timing->sdadel << TIMINGR_SDADEL_Pos) |
+            (timing->sclh << TIMINGR_SCLH_Pos) |
+            (timing->scll << TIMINGR_SCLL_Pos);
+    }
+
+    return found;
+}
+
+#ifdef HAL5_I2C_TIMING_TESTS
+
+// checks the result against the specification
+// times are compared in ns * ker_ck, so there is no rounding
+static bool check_timing(
+        const uint32_t ker_ck,
+        const uint32_t speed,
+        const uint32_t rise_ns,
+        const uint32_t fall_ns,
+        const hal5_i2c_timing_t* t)
+{
+    const spec_t* spec = &specs[(speed <= 100000) ? 0 :
+        ((speed <= 400000) ? 1 : 2)];
+
+    const int64_t ck = ker_ck;
+    const int64_t tpresc = (int64_t) (t->presc + 1) * 1000000000;
+    const int64_t tclk = 1000000000;
+
+    if ((t->scll + 1) * tpresc < spec->tlow_min * ck) return false;
+
+    if ((t->sclh + 1) * tpresc < spec->thigh_min * ck) return false;
+
+    if ((t->scldel + 1) * tpresc < (rise_ns + spec->tsudat_min) * ck)
+        return false;
+
+    const int64_t sdadel = t->sdadel * tpresc;
+
+    if ((sdadel + (TAF_MIN * ck) + (3 * tclk)) < (fall_ns * ck))
+        return false;
+
+    if ((sdadel + ((rise_ns + TAF_MAX) * ck) + (4 * tclk)) >
+            (spec->tvddat_max * ck))
+        return false;
+
+    if (t->speed > speed) return false;
+
+    return true;
+}
+
+// RM0481 examples of timing settings, Standard-mode
+// with the maximum rise and fall times of Standard-mode, the reference 
+// has to meet the specification and the solver has to find a timing at 
+// least as fast
+// Fast-mode and Fast-mode Plus examples count tSYNC1 in tLOW, which is 
+// kept as a margin here, so they do not pass check_timing
+typedef struct
+{
+    uint32_t ker_ck;
+    uint32_t speed;
+    uint32_t timingr;
+} timing_ref_t;
+
+static const timing_ref_t timing_refs[] = {
+    {8000000, 100000, 0x10420F13},
+    {16000000, 100000, 0x30420F13},
+};
+
+static void decode_timingr(
+        const uint32_t ker_ck,
+        const uint32_t rise_ns,
+        const uint32_t fall_ns,
+        const uint32_t timingr,
+        hal5_i2c_timing_t* t)
+{
+    t->presc = (timingr >> TIMINGR_PRESC_Pos) & 0xF;
+    t->scldel = (timingr >> TIMINGR_SCLDEL_Pos) & 0xF;
+    t->sdadel = (timingr >> TIMINGR_SDADEL_Pos) & 0xF;
+    t->sclh = (timingr >> TIMINGR_SCLH_Pos) & 0xFF;
+    t->scll = (timingr >> TIMINGR_SCLL_Pos) & 0xFF;
+    t->timingr = timingr;
+
+    const int64_t period = 
+        ((int64_t) (t->scll + 1 + t->sclh + 1) * (t->presc + 1)) + 
+        sync_cycles(ker_ck, rise_ns, fall_ns);
+
+    t->speed = (uint32_t) (ker_ck / period);
+}
+
+static const uint32_t timing_clocks[] = {
+    4000000, 8000000, 16000000, 24000000, 32000000, 48000000,
+    64000000, 80000000, 100000000, 120000000, 125000000, 160000000,
+    200000000, 240000000, 250000000
+};
+
+typedef struct
+{
+    uint32_t speed;
+    uint32_t rise_ns;
+    uint32_t fall_ns;
+    // specification can only be met with ker_ck in this range
+    uint32_t min_ker_ck;
+    uint32_t max_ker_ck;
+} timing_test_t;
+
+static const timing_test_t timing_tests[] = {
+    // SCLDEL cannot be more than 16 * 16 I2CCLK cycles, too short 
+    // for tr + tSU;DAT above 200 MHz
+    {100000, 1000, 300, 4000000, 200000000},
+    {100000, 100, 10, 4000000, 250000000},
+    // 4 I2CCLK cycles of SDADEL upper limit is too long at low clocks
+    {400000, 300, 300, 16000000, 250000000},
+    {400000, 100, 10, 8000000, 250000000},
+    // never possible with the analog filter delay
+    {1000000, 120, 120, 1, 0},
+    {1000000, 50, 10, 32000000, 250000000},
+};
+
+bool hal5_i2c_timing_test()
+{
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < (sizeof(timing_tests) / sizeof(timing_test_t)); i++)
+    {
+        const timing_test_t* t = &timing_tests[i];
+
+        for (uint32_t j = 0;
+                j < (sizeof(timing_clocks) / sizeof(uint32_t));
+                j++)
+        {
+            const uint32_t ker_ck = timing_clocks[j];
+            hal5_i2c_timing_t timing;
+
+            const bool found = hal5_i2c_calculate_timing(
+                    ker_ck, t->speed, t->rise_ns, t->fall_ns, &timing);
+
+            bool ok = (found == 
+                    ((ker_ck >= t->min_ker_ck) && (ker_ck <= t->max_ker_ck)));
+            if (ok && found)
+            {
+                ok = check_timing(
+                        ker_ck, t->speed, t->rise_ns, t->fall_ns, &timing);
+            }
+
+            if (!ok)
+            {
+                printf("I2C timing test %lu FAIL: %lu %lu\n",
+                        (unsigned long) i, (unsigned long) ker_ck, 
+                        (unsigned long) t->speed);
+                failed++;
+            }
+        }
+    }
+
+    hal5_i2c_timing_t timing;
+
+    for (uint32_t i = 0; i < (sizeof(timing_refs) / sizeof(timing_ref_t)); i++)
+    {
+        const timing_ref_t* r = &timing_refs[i];
+        hal5_i2c_timing_t ref;
+
+        decode_timingr(r->ker_ck, 1000, 300, r->timingr, &ref);
+
+        if (!check_timing(r->ker_ck, r->speed, 1000, 300, &ref) ||
+                !hal5_i2c_calculate_timing(
+                    r->ker_ck, r->speed, 1000, 300, &timing) ||
+                (timing.speed < ref.speed))
+        {
+            printf("I2C timing test FAIL: RM0481 0x%08lX\n", 
+                    (unsigned long) r->timingr);
+            failed++;
+        }
+    }
+
+    // regression value, output of this solver, not a reference
+    // fastest timing is found, 400 kHz exactly
+    if (!hal5_i2c_calculate_timing(64000000, 400000, 100, 10, &timing) ||
+            (timing.timingr != 0x00C0305D) || (timing.speed != 400000))
+    {
+        printf("I2C timing test FAIL: 64000000 400000\n");
+        failed++;
+    }
+
+    // rise time is more than the specification allows
+    if (hal5_i2c_calculate_timing(64000000, 400000, 1000, 300, &timing) ||
+            hal5_i2c_calculate_timing(64000000, 3400000, 10, 10, &timing) ||
+            hal5_i2c_calculate_timing(0, 100000, 10, 10, &timing))
+    {
+        printf("I2C timing test FAIL: invalid input\n");
+        failed++;
+    }
+
+    printf("I2C timing tests: %s\n", (failed == 0) ? "OK" : "FAIL");
+
+    return (failed == 0);
+}
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <stm32h5xx.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// a record is sent as:
+// 0x01, COBS encoded payload, 0x00
+// payload is the address of the format string and the arguments
+// each as an unsigned LEB128
+// console text never contains 0x01 or 0x00, so records can be mixed
+// with printf output, COBS encoding removes 0x00 from the payload
+
+#define LOG_START 0x01
+#define LOG_END 0x00
+
+#define LOG_MAX_ARGS 8
+
+// a 32-bit value is max. 5 bytes in LEB128
+#define LOG_MAX_PAYLOAD (5 * (1 + LOG_MAX_ARGS))
+
+static uint32_t put_leb128(
+        uint8_t* p,
+        uint32_t v)
+{
+    uint32_t n = 0;
+
+    while (v >= 0x80)
+    {
+        p[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+
+    p[n++] = v;
+
+    return n;
+}
+
+void hal5_log(
+        const char* f,
+        const uint32_t nargs,
+        ...)
+{
+    assert (nargs <= LOG_MAX_ARGS);
+
+    uint8_t payload[LOG_MAX_PAYLOAD];
+
+    // .hal5_log is not allocated, so this is an offset in .hal5_log
+    uint32_t len = put_leb128(payload, (uint32_t) f);
+
+    va_list ap;
+    va_start(ap, nargs);
+
+    for (uint32_t i = 0; i < nargs; i++)
+    {
+        len += put_leb128(&payload[len], va_arg(ap, uint32_t));
+    }
+
+    va_end(ap);
+
+    // payload is less than 254 bytes, so COBS needs only one overhead byte
+    // start, overhead, payload, end
+    uint8_t record[1 + 1 + LOG_MAX_PAYLOAD + 1];
+
+    record[0] = LOG_START;
+    uint32_t n = 1 + hal5_cobs_encode(payload, len, &record[1]);
+    record[n++] = LOG_END;
+
+    // printf output is buffered, write it first to keep the order
+    fflush(stdout);
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        hal5_console_write(record[i]);
+    }
+}
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+#
+# SPDX-FileCopyrightText: 2023 Mete Balci
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Copyright (c) 2023 Mete Balci
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# decodes the tokenized HAL5_LOG records (see hal5_log.c) in the console
+# output back to text, other console output is passed as it is
+#
+# format strings are read from .hal5_log section of the ELF file, which
+# is not loaded to the MCU
+#
+# usage: hal5_log_decode.py hal5.elf [input]
+#
+# input is a file or a serial device, stdin if not given
+# a serial device has to be configured before, e.g.:
+#   stty -F /dev/ttyACM0 921600 raw
+#   hal5_log_decode.py hal5.elf /dev/ttyACM0
+
+import re
+import struct
+import sys
+
+from hal5_cobs import cobs_decode
+
+LOG_START = 0x01
+# hal5_telemetry frames, skipped
+FRAME_START = 0x02
+LOG_END = 0x00
+
+def read_section(path, name):
+    data = open(path, 'rb').read()
+    assert data[0:4] == b'\x7fELF', 'not an ELF file'
+    is64 = (data[4] == 2)
+    endian = '<' if data[5] == 1 else '>'
+    if is64:
+        shoff, = struct.unpack_from(endian + 'Q', data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', data, 0x3A)
+        fmt = endian + 'IIQQQQIIQQ'
+    else:
+        shoff, = struct.unpack_from(endian + 'I', data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', data, 0x2E)
+        fmt = endian + 'IIIIIIIIII'
+    sections = [struct.unpack_from(fmt, data, shoff + i * shentsize)
+            for i in range(shnum)]
+    strtab = sections[shstrndx]
+    for s in sections:
+        start = strtab[4] + s[0]
+        sname = data[start:data.index(b'\x00', start)].decode()
+        if sname == name:
+            # sh_addr, sh_offset, sh_size
+            return s[3], data[s[4]:s[4] + s[5]]
+    raise Exception('%s section not found' % name)
+
+# converts a C printf conversion to python
+# only 32-bit arguments are supported
+CONVERSION = re.compile(r'%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diuxXocp%])')
+
+def format_text(fmt, args):
+    out = []
+    pos = 0
+    i = 0
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, _, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        if i >= len(args):
+            out.append('<missing>')
+            continue
+        v = args[i]
+        i += 1
+        spec = '%' + flags + width + (('.' + precision) if precision else '')
+        if conv in 'di':
+            out.append((spec + 'd') % (v - (1 << 32) if v & 0x80000000 else v))
+        elif conv == 'c':
+            out.append((spec + 'c') % chr(v & 0xFF))
+        elif conv == 'p':
+            out.append('0x%08x' % v)
+        else:
+            out.append((spec + conv) % v)
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+def leb128_values(data):
+    values = []
+    v = 0
+    shift = 0
+    for b in data:
+        v |= (b & 0x7F) << shift
+        shift += 7
+        if (b & 0x80) == 0:
+            values.append(v)
+            v = 0
+            shift = 0
+    if shift != 0:
+        return None
+    return values
+
+def decode_record(addr, strings, record):
+    payload = cobs_decode(record)
+    values = leb128_values(payload) if payload is not None else None
+    if not values:
+        return '<invalid record %s>\n' % record.hex()
+    offset = values[0] - addr
+    if offset < 0 or offset >= len(strings):
+        return '<unknown format 0x%08x>\n' % values[0]
+    end = strings.index(b'\x00', offset)
+    return format_text(strings[offset:end].decode(errors='replace'), values[1:])
+
+def main():
+    if len(sys.argv) < 2:
+        print('usage: %s ELF [input]' % sys.argv[0], file=sys.stderr)
+        sys.exit(1)
+
+    addr, strings = read_section(sys.argv[1], '.hal5_log')
+
+    f = open(sys.argv[2], 'rb', buffering=0) if len(sys.argv) > 2 \
+            else sys.stdin.buffer
+    out = sys.stdout
+
+    record = None
+    start = None
+    while True:
+        data = f.read(256)
+        if not data:
+            break
+        for b in data:
+            if record is not None:
+                if b == LOG_END:
+                    if start == LOG_START:
+                        out.write(decode_record(addr, strings, bytes(record)))
+                    record = None
+                else:
+                    record.append(b)
+            elif b == LOG_START or b == FRAME_START:
+                start = b
+                record = bytearray()
+            else:
+                out.write(chr(b))
+        out.flush()
+
+if __name__ == '__main__':
+    main()
@@ -26,18 +26,11 @@
 #include "hal5.h"
 #include "hal5_private.h"
 
-static uint32_t lpuart_baud;
+static hal5_lpuart_brr_t lpuart_brr;
 
 void hal5_lpuart_configure(
         const uint32_t baud)
 {
-    assert (baud <= 921600);
-    assert (baud >= 115200);
-
-    lpuart_baud = baud;
-
-    hal5_rcc_enable_csi();
-
     // using LPUART1 as console
     // PB6 is TX, PB7 is RX, both AF8
     hal5_gpio_configure_as_af(
@@ -55,23 +48,67 @@ void hal5_lpuart_configure(
     // enable LPUART1 clock
     hal5_rcc_enable_lpuart1();
 
-    // set lpuart_ker_ck to csi_ker_ck
-    hal5_rcc_change_lpuart1_ker_ck(lpuart1sel_csi_ker_ck);
+    // PRESC and BRR can only be written when UART is disabled
+    CLEAR_BIT(LPUART1->CR1, USART_CR1_UE);
+
+    // candidates for lpuart1_ker_ck
+    // a later one is used only if its error is smaller
+    // pclk3 changes with sys_ck, so it is used only if neither csi_ker_ck
+    // nor hsi_ker_ck is within HAL5_LPUART_MAX_ERROR_PPM
+    // pll2_q_ck and pll3_q_ck are not supported by hal5_rcc yet
+    const hal5_rcc_lpuart1sel_t sources[] = {
+        lpuart1sel_csi_ker_ck,
+        lpuart1sel_hsi_ker_ck,
+        lpuart1sel_pclk3,
+    };
+
+    const uint32_t ker_cks[] = {
+        hal5_rcc_get_csi_ker_ck(),
+        hal5_rcc_get_hsi_ker_ck(),
+        hal5_rcc_get_pclk3(),
+    };
+
+    bool found = false;
+    hal5_rcc_lpuart1sel_t source = lpuart1sel_csi_ker_ck;
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        hal5_lpuart_brr_t brr;
+
+        const int32_t best = (lpuart_brr.error_ppm < 0) ? 
+            -lpuart_brr.error_ppm : lpuart_brr.error_ppm;
+
+        if ((sources[i] == lpuart1sel_pclk3) && found && 
+                (best <= HAL5_LPUART_MAX_ERROR_PPM)) continue;
+
+        if (!hal5_lpuart_calculate_brr(ker_cks[i], baud, &brr)) continue;
+        const int32_t error = (brr.error_ppm < 0) ? 
+            -brr.error_ppm : brr.error_ppm;
+
+        if (!found || (error < best))
+        {
+            lpuart_brr = brr;
+            source = sources[i];
+            found = true;
+        }
+    }
+
+    // baud is more than lpuart1_ker_ck / 3 or too low
+    assert (found);
+
+    switch (source)
+    {
+        case lpuart1sel_csi_ker_ck: hal5_rcc_enable_csi(); break;
+        case lpuart1sel_hsi_ker_ck: hal5_rcc_enable_hsi(); break;
+        default: break;
+    }
+
+    hal5_rcc_change_lpuart1_ker_ck(source);
 
-    // PRESC is not needed for 115200 to 921600 bauds with csi (or hsi)
-    /*
-       MODIFY_REG(LPUART1->PRESC, LPUART_PRESC_PRESCALER_Msk,
-       0b0000 << LPUART_PRESC_PRESCALER_Pos);
-       */
+    MODIFY_REG(LPUART1->PRESC, USART_PRESC_PRESCALER_Msk,
+            lpuart_brr.presc_bits << USART_PRESC_PRESCALER_Pos);
 
-    // original equation is 256 * clock / baud
-    // to not reach 32-bit with multiplication, first division is performed
-    // because a standard baud is already an integer factor of 256
-    assert (lpuart_baud % 256 == 0);
-    const uint32_t BRR = hal5_rcc_get_lpuart1_ker_ck() / (lpuart_baud / 256);
-    assert (BRR >= 0x300);
-    assert (BRR <= 0xFFFFF);
-    LPUART1->BRR = BRR;
+    LPUART1->BRR = lpuart_brr.brr;
 
     // enable FIFO
     SET_BIT(LPUART1->CR1, USART_CR1_FIFOEN);
@@ -83,7 +120,418 @@ void hal5_lpuart_configure(
     SET_BIT(LPUART1->CR1, USART_CR1_RE);
 }
 
-void hal5_lpuart_write(
+uint32_t hal5_lpuart_get_baud()
+{
+    return lpuart_brr.baud;
+}
+
+int32_t hal5_lpuart_get_baud_error_ppm()
+{
+    return lpuart_brr.error_ppm;
+}
+
+// TX ring buffer, emptied to TX FIFO by LPUART1 interrupt
+// head and tail are free running, tx_size is a power of 2
+// producers (hal5_lpuart_write) run in a critical section
+// so it can also be used from interrupt handlers
+static uint8_t* tx_buffer = NULL;
+static uint32_t tx_size;
+static hal5_lpuart_overflow_t tx_policy;
+static volatile uint32_t tx_head;
+static volatile uint32_t tx_tail;
+static volatile uint32_t tx_dropped;
+
+// moves characters from the ring to TX FIFO until one of them is full
+// called with interrupts disabled or from the interrupt handler
+static void tx_fill_fifo()
+{
+    while ((tx_head != tx_tail) &&
+            (LPUART1->ISR & USART_ISR_TXE_Msk))
+    {
+        LPUART1->TDR = tx_buffer[tx_tail & (tx_size - 1)];
+        tx_tail = tx_tail + 1;
+    }
+}
+
+// same as the interrupt handler, but can be used when
+// the interrupt cannot run, e.g. in a fault handler
+static void tx_poll()
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    tx_fill_fifo();
+    __set_PRIMASK(primask);
+}
+
+static void tx_irq()
+{
+    tx_fill_fifo();
+
+    // nothing more to send, enabled again by hal5_lpuart_write
+    if (tx_head == tx_tail)
+    {
+        CLEAR_BIT(LPUART1->CR3, USART_CR3_TXFTIE);
+    }
+}
+
+// RX ring buffer, filled by LPUART1 interrupt
+// an idle line marks the end of a frame
+// LPUART has no receiver timeout (RTOR), so only IDLE is used
+#define RX_FRAMES 8
+
+static uint8_t* rx_buffer = NULL;
+static uint32_t rx_size;
+static volatile uint32_t rx_head;
+static volatile uint32_t rx_tail;
+// rx_head at the end of each frame, free running
+static volatile uint32_t rx_frame_ends[RX_FRAMES];
+static volatile uint32_t rx_frame_head;
+static volatile uint32_t rx_frame_tail;
+static volatile uint32_t rx_overruns;
+static volatile uint32_t rx_dropped;
+
+static void rx_irq(
+        const uint32_t isr)
+{
+    if (isr & USART_ISR_ORE)
+    {
+        LPUART1->ICR = USART_ICR_ORECF;
+        rx_overruns = rx_overruns + 1;
+    }
+
+    // RXNE and RXFNE bit numbers are same
+    while (LPUART1->ISR & USART_ISR_RXNE_Msk)
+    {
+        const uint8_t ch = LPUART1->RDR;
+
+        if ((rx_head - rx_tail) == rx_size)
+        {
+            rx_dropped = rx_dropped + 1;
+        }
+        else
+        {
+            rx_buffer[rx_head & (rx_size - 1)] = ch;
+            rx_head = rx_head + 1;
+        }
+    }
+
+    if (isr & USART_ISR_IDLE)
+    {
+        LPUART1->ICR = USART_ICR_IDLECF;
+
+        const uint32_t nframes = rx_frame_head - rx_frame_tail;
+        volatile uint32_t* last_end = 
+            &rx_frame_ends[(rx_frame_head - 1) & (RX_FRAMES - 1)];
+
+        if ((nframes > 0) && (*last_end == rx_head))
+        {
+            // nothing received since the last frame
+        }
+        else if (nframes == RX_FRAMES)
+        {
+            // no space for a new frame, it is merged with the last one
+            *last_end = rx_head;
+        }
+        else
+        {
+            rx_frame_ends[rx_frame_head & (RX_FRAMES - 1)] = rx_head;
+            rx_frame_head = rx_frame_head + 1;
+        }
+    }
+}
+
+void LPUART1_IRQHandler(void)
+{
+    const uint32_t isr = LPUART1->ISR;
+
+    if ((LPUART1->CR3 & USART_CR3_TXFTIE) && (isr & USART_ISR_TXFT))
+    {
+        tx_irq();
+    }
+
+    if (rx_buffer != NULL) rx_irq(isr);
+}
+
+void hal5_lpuart_enable_rx_buffer(
+        uint8_t* buffer,
+        const uint32_t size)
+{
+    // size has to be a power of 2
+    assert (size > 0);
+    assert ((size & (size - 1)) == 0);
+
+    CLEAR_BIT(LPUART1->CR1, USART_CR1_IDLEIE);
+    CLEAR_BIT(LPUART1->CR3, USART_CR3_RXFTIE);
+
+    rx_buffer = buffer;
+    rx_size = size;
+    rx_head = 0;
+    rx_tail = 0;
+    rx_frame_head = 0;
+    rx_frame_tail = 0;
+    rx_overruns = 0;
+    rx_dropped = 0;
+
+    LPUART1->ICR = USART_ICR_ORECF | USART_ICR_IDLECF;
+
+    // RXFT is set when RX FIFO is 3/4 full
+    // the rest is read when the line becomes idle
+    MODIFY_REG(LPUART1->CR3, USART_CR3_RXFTCFG_Msk,
+            0b011 << USART_CR3_RXFTCFG_Pos);
+
+    SET_BIT(LPUART1->CR3, USART_CR3_RXFTIE);
+    SET_BIT(LPUART1->CR1, USART_CR1_IDLEIE);
+
+    NVIC_EnableIRQ(LPUART1_IRQn);
+}
+
+uint32_t hal5_lpuart_read_frame(
+        uint8_t* frame,
+        const uint32_t max_len)
+{
+    assert (rx_buffer != NULL);
+
+    while (rx_frame_head != rx_frame_tail)
+    {
+        const uint32_t end = rx_frame_ends[rx_frame_tail & (RX_FRAMES - 1)];
+        rx_frame_tail = rx_frame_tail + 1;
+
+        // frame might already be consumed by hal5_lpuart_read
+        const uint32_t len = end - rx_tail;
+        if ((int32_t) len <= 0) continue;
+
+        const uint32_t n = (len < max_len) ? len : max_len;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            frame[i] = rx_buffer[(rx_tail + i) & (rx_size - 1)];
+        }
+
+        // rest of the frame is discarded if it does not fit
+        rx_tail = end;
+
+        return len;
+    }
+
+    return 0;
+}
+
+uint32_t hal5_lpuart_get_rx_overruns()
+{
+    return rx_overruns;
+}
+
+uint32_t hal5_lpuart_get_rx_dropped()
+{
+    return rx_dropped;
+}
+
+void hal5_lpuart_enable_tx_buffer(
+        uint8_t* buffer,
+        const uint32_t size,
+        const hal5_lpuart_overflow_t policy)
+{
+    // size has to be a power of 2
+    assert (size > 0);
+    assert ((size & (size - 1)) == 0);
+
+    hal5_lpuart_disable_tx_buffer();
+
+    tx_buffer = buffer;
+    tx_size = size;
+    tx_policy = policy;
+    tx_head = 0;
+    tx_tail = 0;
+    tx_dropped = 0;
+
+    // TXFT is set when TX FIFO is half empty
+    MODIFY_REG(LPUART1->CR3, USART_CR3_TXFTCFG_Msk,
+            0b010 << USART_CR3_TXFTCFG_Pos);
+
+    NVIC_EnableIRQ(LPUART1_IRQn);
+}
+
+static void write_buffered(
+        const char ch)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((tx_head - tx_tail) == tx_size)
+    {
+        switch (tx_policy)
+        {
+            case hal5_lpuart_overflow_drop:
+                tx_dropped = tx_dropped + 1;
+                __set_PRIMASK(primask);
+                return;
+
+            case hal5_lpuart_overflow_overwrite:
+                // oldest character is lost
+                tx_tail = tx_tail + 1;
+                tx_dropped = tx_dropped + 1;
+                break;
+
+            case hal5_lpuart_overflow_block:
+                // polled, so it also works when the interrupt cannot run
+                while ((tx_head - tx_tail) == tx_size)
+                {
+                    tx_fill_fifo();
+                }
+                break;
+        }
+    }
+
+    tx_buffer[tx_head & (tx_size - 1)] = ch;
+    tx_head = tx_head + 1;
+
+    // TXFT is set only when the FIFO level reaches the threshold
+    // so FIFO is filled first, then the interrupt is enabled
+    if ((LPUART1->CR3 & USART_CR3_TXFTIE) == 0)
+    {
+        tx_fill_fifo();
+        SET_BIT(LPUART1->CR3, USART_CR3_TXFTIE);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+// DMA TX with double buffering
+// application fills dma_buffers[dma_fill] while the other one is sent
+// the buffers swap when the DMA transfer completes
+static uint8_t* dma_buffers[2] = {NULL, NULL};
+static uint32_t dma_size;
+static volatile uint32_t dma_fill;
+static volatile uint32_t dma_fill_len;
+// set between acquire and commit, fill buffer cannot be sent meanwhile
+static volatile bool dma_acquired;
+static uint32_t dma_acquired_len;
+
+static void tx_dma_callback(const bool error);
+
+// called with interrupts disabled or from the DMA interrupt handler
+static void tx_dma_start_next()
+{
+    if (dma_acquired) return;
+    if (dma_fill_len == 0) return;
+    if (hal5_dma_is_busy(hal5_dma_channel_lpuart1_tx)) return;
+
+    hal5_dma_start(
+            hal5_dma_channel_lpuart1_tx,
+            hal5_dma_request_lpuart1_tx,
+            true,
+            &LPUART1->TDR,
+            dma_buffers[dma_fill],
+            dma_fill_len,
+            hal5_dma_width_byte,
+            tx_dma_callback);
+
+    dma_fill = dma_fill ^ 1;
+    dma_fill_len = 0;
+}
+
+static void tx_dma_callback(const bool error)
+{
+    if (error) tx_dropped = tx_dropped + 1;
+
+    tx_dma_start_next();
+}
+
+// starts the next transfer without the DMA interrupt
+// so it also works in a fault handler
+static void tx_dma_poll()
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    tx_dma_start_next();
+    __set_PRIMASK(primask);
+}
+
+void hal5_lpuart_enable_tx_dma(
+        uint8_t* buffer0,
+        uint8_t* buffer1,
+        const uint32_t size)
+{
+    assert (buffer0 != NULL);
+    assert (buffer1 != NULL);
+    // BNDT is 16-bit
+    assert (size > 0);
+    assert (size <= 0xFFFF);
+
+    hal5_lpuart_disable_tx_buffer();
+
+    hal5_dma_enable();
+
+    dma_buffers[0] = buffer0;
+    dma_buffers[1] = buffer1;
+    dma_size = size;
+    dma_fill = 0;
+    dma_fill_len = 0;
+    dma_acquired = false;
+    tx_dropped = 0;
+
+    SET_BIT(LPUART1->CR3, USART_CR3_DMAT);
+}
+
+uint8_t* hal5_lpuart_tx_dma_acquire(
+        const uint32_t len)
+{
+    assert (dma_buffers[0] != NULL);
+    assert (!dma_acquired);
+    assert (len <= dma_size);
+
+    while (true)
+    {
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        const uint32_t fill_len = dma_fill_len;
+
+        if ((dma_size - fill_len) >= len)
+        {
+            dma_acquired = true;
+            dma_acquired_len = len;
+            __set_PRIMASK(primask);
+            return &dma_buffers[dma_fill][fill_len];
+        }
+
+        // not enough space in fill buffer
+        // it is sent as it is when the other one is sent
+        tx_dma_start_next();
+
+        __set_PRIMASK(primask);
+    }
+}
+
+void hal5_lpuart_tx_dma_commit(
+        const uint32_t len)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    assert (dma_acquired);
+    assert (len <= dma_acquired_len);
+
+    dma_fill_len = dma_fill_len + len;
+    dma_acquired = false;
+
+    tx_dma_start_next();
+
+    __set_PRIMASK(primask);
+}
+
+void hal5_lpuart_disable_tx_buffer()
+{
+    hal5_lpuart_flush();
+
+    CLEAR_BIT(LPUART1->CR3, USART_CR3_TXFTIE | USART_CR3_DMAT);
+
+    tx_buffer = NULL;
+    dma_buffers[0] = NULL;
+    dma_buffers[1] = NULL;
+}
+
+static void write_direct(
         const char ch)
 {
     // TXE and TXFNF bit numbers are same
@@ -92,9 +540,128 @@ void hal5_lpuart_write(
     LPUART1->TDR = ch;
 }
 
+// characters are appended to the fill buffer in one critical section
+// (not with acquire and commit), and they are sent together when the 
+// other buffer is sent
+static void write_dma(
+        const char ch)
+{
+    while (true)
+    {
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        if (dma_acquired)
+        {
+            __set_PRIMASK(primask);
+
+            // only the assert and fault handlers should come here
+            // fill buffer cannot be sent, so the character is written 
+            // to TDR after the transfer in progress
+            while (hal5_dma_is_busy(hal5_dma_channel_lpuart1_tx));
+            write_direct(ch);
+            return;
+        }
+
+        const uint32_t fill_len = dma_fill_len;
+
+        if (fill_len < dma_size)
+        {
+            dma_buffers[dma_fill][fill_len] = ch;
+            dma_fill_len = fill_len + 1;
+            tx_dma_start_next();
+            __set_PRIMASK(primask);
+            return;
+        }
+
+        // fill buffer is full
+        // it is sent as it is when the other one is sent
+        tx_dma_start_next();
+
+        __set_PRIMASK(primask);
+    }
+}
+
+void hal5_lpuart_write(
+        const char ch)
+{
+    if (tx_buffer != NULL)
+    {
+        write_buffered(ch);
+        return;
+    }
+
+    if (dma_buffers[0] != NULL)
+    {
+        write_dma(ch);
+        return;
+    }
+
+    write_direct(ch);
+}
+
+static void flush(
+        const bool check)
+{
+    if (tx_buffer != NULL)
+    {
+        while (tx_head != tx_tail) tx_poll();
+    }
+
+    if (dma_buffers[0] != NULL)
+    {
+        // fill buffer is never sent while it is acquired
+        if (check) assert (!dma_acquired);
+
+        if (dma_acquired)
+        {
+            while (hal5_dma_is_busy(hal5_dma_channel_lpuart1_tx));
+        }
+        else
+        {
+            while ((dma_fill_len != 0) || 
+                    hal5_dma_is_busy(hal5_dma_channel_lpuart1_tx))
+            {
+                tx_dma_poll();
+            }
+        }
+    }
+
+    // wait until the last character is sent
+    if (READ_BIT(LPUART1->CR1, USART_CR1_TE))
+    {
+        while ((LPUART1->ISR & USART_ISR_TC) == 0);
+    }
+}
+
+void hal5_lpuart_flush()
+{
+    flush(true);
+}
+
+void hal5_lpuart_flush_fault()
+{
+    flush(false);
+}
+
+uint32_t hal5_lpuart_get_tx_dropped()
+{
+    return tx_dropped;
+}
+
 bool hal5_lpuart_read(
         char* ch)
 {
+    if (rx_buffer != NULL)
+    {
+        if (rx_head == rx_tail) return false;
+
+        *ch = rx_buffer[rx_tail & (rx_size - 1)];
+        rx_tail = rx_tail + 1;
+
+        return true;
+    }
+
     if (LPUART1->ISR & USART_ISR_RXNE_Msk) {
         *ch = LPUART1->RDR;
         return true;
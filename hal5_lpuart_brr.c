@@ -0,0 +1,140 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// BRR calculation is kept separate from the register access
+// so it can also be compiled and tested on a PC (make host-test)
+
+// PRESC.PRESCALER 0b0000 to 0b1011
+static const uint32_t prescalers[] = {
+    1, 2, 4, 6, 8, 10, 12, 16, 32, 64, 128, 256
+};
+
+#define BRR_MIN 0x300
+#define BRR_MAX 0xFFFFF
+
+bool hal5_lpuart_calculate_brr(
+        const uint32_t ker_ck,
+        const uint32_t baud,
+        hal5_lpuart_brr_t* brr)
+{
+    assert (brr != NULL);
+
+    if ((ker_ck == 0) || (baud == 0)) return false;
+
+    bool found = false;
+    uint32_t best_abs_error = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < (sizeof(prescalers) / sizeof(uint32_t)); i++)
+    {
+        const uint64_t div = (uint64_t) prescalers[i] * baud;
+
+        // rounded 256 * ker_ck / (presc * baud)
+        const uint64_t v = (((uint64_t) ker_ck * 256) + (div / 2)) / div;
+
+        if ((v < BRR_MIN) || (v > BRR_MAX)) continue;
+
+        const uint64_t ck = (uint64_t) ker_ck * 256;
+        const uint64_t d = (uint64_t) prescalers[i] * v;
+        const uint32_t actual = (uint32_t) ((ck + (d / 2)) / d);
+
+        const int64_t diff = (int64_t) actual - (int64_t) baud;
+        const int32_t error_ppm = (int32_t) ((diff * 1000000) / baud);
+        const uint32_t abs_error = (error_ppm < 0) ? -error_ppm : error_ppm;
+
+        // smaller prescaler is kept on equal error, its BRR is larger
+        if (abs_error < best_abs_error)
+        {
+            best_abs_error = abs_error;
+            brr->presc = prescalers[i];
+            brr->presc_bits = i;
+            brr->brr = (uint32_t) v;
+            brr->baud = actual;
+            brr->error_ppm = error_ppm;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+#ifdef HAL5_LPUART_BRR_TESTS
+
+typedef struct
+{
+    uint32_t ker_ck;
+    uint32_t baud;
+    bool found;
+    uint32_t presc;
+    uint32_t brr;
+} brr_test_t;
+
+static const brr_test_t brr_tests[] = {
+    // previous fixed configuration, csi_ker_ck
+    {4000000, 115200, true, 1, 8889},
+    {4000000, 921600, true, 1, 1111},
+    // max. is ker_ck / 3
+    {4000000, 1333333, true, 1, 768},
+    {4000000, 1400000, false, 0, 0},
+    {64000000, 21333333, true, 1, 768},
+    {64000000, 9600, true, 2, 853333},
+    // BRR is more than 20 bits without prescaler
+    {250000000, 9600, true, 8, 833333},
+    // BRR would be 0x100000 without prescaler
+    {32768, 8, true, 2, 524288},
+    {0, 9600, false, 0, 0},
+};
+
+bool hal5_lpuart_brr_test()
+{
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < (sizeof(brr_tests) / sizeof(brr_test_t)); i++)
+    {
+        const brr_test_t* t = &brr_tests[i];
+        hal5_lpuart_brr_t brr;
+
+        const bool found = hal5_lpuart_calculate_brr(t->ker_ck, t->baud, &brr);
+
+        bool ok = (found == t->found);
+        if (ok && found)
+        {
+            ok = (brr.presc == t->presc) && (brr.brr == t->brr);
+        }
+
+        if (!ok)
+        {
+            printf("BRR test %lu FAIL: %lu %lu\n", (unsigned long) i, 
+                    (unsigned long) t->ker_ck, (unsigned long) t->baud);
+            failed++;
+        }
+    }
+
+    printf("BRR tests: %s\n", (failed == 0) ? "OK" : "FAIL");
+
+    return (failed == 0);
+}
+
+#endif
@@ -36,6 +36,12 @@
 extern "C" {
 #endif
 
+// see hal5_cobs.c
+uint32_t hal5_cobs_encode(
+        const uint8_t* in,
+        const uint32_t len,
+        uint8_t* out);
+
 #ifdef __cplusplus
 }
 #endif
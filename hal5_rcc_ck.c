@@ -320,7 +320,7 @@ static uint32_t hal5_rcc_get_rcc_pclk3()
 } 
 
 // alias
-static uint32_t hal5_rcc_get_pclk3() 
+uint32_t hal5_rcc_get_pclk3() 
 {
   return hal5_rcc_get_rcc_pclk3();
 }
@@ -399,16 +399,28 @@ uint32_t hal5_rcc_get_i2c_ker_ck(uint32_t n)
 
 }
 
+static void dump_clock(
+        const char* name,
+        const uint32_t v,
+        const char* unit)
+{
+  hal5_console_write_string(name);
+  hal5_console_write_uint(v, 3);
+  hal5_console_write_string(unit);
+}
+
 void hal5_rcc_dump_clock_info(void)
 {
   const uint32_t K = 1000;
   const uint32_t M = 1000000;
 
-  CONSOLE("CSI     : %3lu MHz\n", hal5_rcc_get_csi_ck() / M);
-  CONSOLE("LSI     : %3lu KHz\n", hal5_rcc_get_lsi_ck() / K);
-  CONSOLE("HSI     : %3lu MHz\n", hal5_rcc_get_hsi_ck() / M);
-  CONSOLE("PLL1_P  : %3lu MHz\n", hal5_rcc_get_pll1_p_ck() / M);
-  CONSOLE("SYSCLK  : %3lu MHz\n", hal5_rcc_get_sys_ck() / M);
-  CONSOLE("HCLK    : %3lu MHz\n", hal5_rcc_get_hclk() / M);
-  CONSOLE("FCLK    : %3lu MHz\n", hal5_rcc_get_fclk() / M);
+  hal5_console_flush_stdout();
+
+  dump_clock("CSI     : ", hal5_rcc_get_csi_ck() / M, " MHz\n");
+  dump_clock("LSI     : ", hal5_rcc_get_lsi_ck() / K, " KHz\n");
+  dump_clock("HSI     : ", hal5_rcc_get_hsi_ck() / M, " MHz\n");
+  dump_clock("PLL1_P  : ", hal5_rcc_get_pll1_p_ck() / M, " MHz\n");
+  dump_clock("SYSCLK  : ", hal5_rcc_get_sys_ck() / M, " MHz\n");
+  dump_clock("HCLK    : ", hal5_rcc_get_hclk() / M, " MHz\n");
+  dump_clock("FCLK    : ", hal5_rcc_get_fclk() / M, " MHz\n");
 }
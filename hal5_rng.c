@@ -37,8 +37,191 @@ void hal5_rng_enable()
     SET_BIT(RNG->CR, RNG_CR_RNGEN);
 }
 
+static volatile uint32_t recoveries;
+static volatile uint32_t recovery_failures;
+// a recovery is started but no data is read since then
+static volatile bool recovering;
+
+// clock error (CECS) clears by itself when rng_clk is correct again
+// seed error (SECS) requires a conditional reset of the RNG
+// interrupt status flags are cleared by writing 0
+// recovery is only started here, it is not waited, RNG generates data 
+// (and a DRDY interrupt) again when it is completed
+// this is called from the interrupt handler, so it never waits
+static void start_recovery()
+{
+    // previous recovery did not succeed
+    if (recovering) recovery_failures = recovery_failures + 1;
+
+    if (RNG->SR & RNG_SR_SECS)
+    {
+        SET_BIT(RNG->CR, RNG_CR_CONDRST);
+        CLEAR_BIT(RNG->CR, RNG_CR_CONDRST);
+    }
+
+    CLEAR_BIT(RNG->SR, RNG_SR_CEIS | RNG_SR_SEIS);
+
+    recovering = true;
+    recoveries = recoveries + 1;
+}
+
+uint32_t hal5_rng_get_recoveries(void)
+{
+    return recoveries;
+}
+
+uint32_t hal5_rng_get_recovery_failures(void)
+{
+    return recovery_failures;
+}
+
+// entropy pool, filled by RNG interrupt
+// single producer (interrupt) and single consumer
+// head and tail are free running, pool_size is a power of 2
+static uint32_t* pool = NULL;
+static uint32_t pool_size;
+static volatile uint32_t pool_head;
+static volatile uint32_t pool_tail;
+static volatile uint32_t pool_underruns;
+
+static bool pool_pop(uint32_t* r)
+{
+    const uint32_t tail = pool_tail;
+
+    if (pool_head == tail) return false;
+
+    *r = pool[tail & (pool_size - 1)];
+    pool_tail = tail + 1;
+
+    // there is space again
+    // CR is also modified by the interrupt handler (CONDRST in
+    // start_recovery), so the read-modify-write cannot be interrupted
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    SET_BIT(RNG->CR, RNG_CR_IE);
+    __set_PRIMASK(primask);
+
+    return true;
+}
+
+void RNG_IRQHandler(void)
+{
+    const uint32_t sr = RNG->SR;
+
+    // clock or seed error, pool is refilled on a later interrupt
+    if (sr & (RNG_SR_CEIS | RNG_SR_SEIS))
+    {
+        start_recovery();
+        return;
+    }
+
+    // only use the data if status is OK
+    while ((RNG->SR & 0x7) == 0x1)
+    {
+        recovering = false;
+
+        if ((pool_head - pool_tail) == pool_size)
+        {
+            // pool is full, enabled again when a word is read
+            CLEAR_BIT(RNG->CR, RNG_CR_IE);
+            return;
+        }
+
+        const uint32_t dr = RNG->DR;
+        if (dr == 0) continue;
+
+        pool[pool_head & (pool_size - 1)] = dr;
+        pool_head = pool_head + 1;
+    }
+}
+
+void hal5_rng_enable_pool(
+        uint32_t* buffer,
+        const uint32_t size)
+{
+    // size has to be a power of 2
+    assert (size > 0);
+    assert ((size & (size - 1)) == 0);
+
+    pool = buffer;
+    pool_size = size;
+    pool_head = 0;
+    pool_tail = 0;
+    pool_underruns = 0;
+
+    NVIC_EnableIRQ(RNG_IRQn);
+    SET_BIT(RNG->CR, RNG_CR_IE);
+}
+
+bool hal5_rng_try_read(
+        uint32_t* r)
+{
+    assert (pool != NULL);
+
+    if (pool_pop(r)) return true;
+
+    pool_underruns = pool_underruns + 1;
+
+    return false;
+}
+
+void hal5_rng_fill(
+        uint8_t* buf,
+        uint32_t len)
+{
+    assert (pool != NULL);
+
+    bool underrun = false;
+
+    while (len > 0)
+    {
+        uint32_t r;
+
+        // pool is empty, wait for the interrupt to refill
+        while (!pool_pop(&r)) underrun = true;
+
+        const uint32_t n = (len < 4) ? len : 4;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            buf[i] = r & 0xFF;
+            r >>= 8;
+        }
+
+        buf += n;
+        len -= n;
+    }
+
+    if (underrun) pool_underruns = pool_underruns + 1;
+}
+
+uint32_t hal5_rng_get_pool_level(void)
+{
+    return pool_head - pool_tail;
+}
+
+uint32_t hal5_rng_get_pool_underruns(void)
+{
+    return pool_underruns;
+}
+
 uint32_t hal5_rng_random()
 {
+    if (pool != NULL)
+    {
+        // RNG data is read by the interrupt, use the pool
+        uint32_t r;
+
+        if (!pool_pop(&r))
+        {
+            // pool is empty, wait for the interrupt to refill
+            pool_underruns = pool_underruns + 1;
+            while (!pool_pop(&r));
+        }
+
+        return r;
+    }
+
     uint32_t dr = 0;
 
     // first wait until status is OK and data is ready
@@ -49,8 +232,10 @@ uint32_t hal5_rng_random()
 
         while ((sr & 0x7) != 0x1) {
             sr = RNG->SR;
+            if (sr & (RNG_SR_CEIS | RNG_SR_SEIS)) start_recovery();
         }
 
+        recovering = false;
         dr = RNG->DR;
 
     }
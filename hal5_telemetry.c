@@ -0,0 +1,64 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <stm32h5xx.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// binary frames on the console (LPUART1), see hal5_telemetry_frame.c
+// for the frame format and hal5_telemetry.py
+
+static uint16_t sequence = 0;
+
+// set while a frame is sent, sequence and the frame bytes on the
+// console are not protected, so it cannot be called again meanwhile
+static volatile bool sending = false;
+
+void hal5_telemetry_send(
+        const uint8_t type,
+        const void* data,
+        const uint32_t len)
+{
+    // not reentrant, e.g. called from an interrupt handler while
+    // the main loop is sending
+    assert (!sending);
+    sending = true;
+
+    uint8_t frame[HAL5_TELEMETRY_MAX_FRAME_LEN];
+
+    const uint32_t n = hal5_telemetry_encode(
+            type, sequence, data, len, frame);
+
+    // printf output is buffered, write it first to keep the order
+    // (not in an interrupt handler, see hal5_console_flush_stdout)
+    hal5_console_flush_stdout();
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        hal5_console_write(frame[i]);
+    }
+
+    sequence++;
+
+    sending = false;
+}
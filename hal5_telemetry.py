@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+#
+# SPDX-FileCopyrightText: 2023 Mete Balci
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Copyright (c) 2023 Mete Balci
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# decoder for the telemetry frames sent by hal5_telemetry_send
+# see hal5_telemetry.c for the frame format
+#
+# as a library:
+#   decoder = hal5_telemetry.Decoder()
+#   for event in decoder.feed(data):
+#       ('frame', type, seq, data) or ('text', bytes) or ('log', bytes)
+#   decoder.frames, decoder.lost, decoder.crc_errors, decoder.invalid
+#
+# usage: hal5_telemetry.py [input]
+#   prints each frame as: type seq data(hex), console text is passed as it is
+#   input is a file or a serial device, stdin if not given
+#   a serial device has to be configured before, e.g.:
+#     stty -F /dev/ttyACM0 921600 raw
+#
+# usage: hal5_telemetry.py --loopback
+#   sends frames mixed with text through a pipe, with some frames lost and
+#   some corrupted, checks that the decoder reports them, prints throughput
+#   also decodes the fixed frames produced by the C encoder (C_VECTORS)
+
+import os
+import struct
+import sys
+import threading
+import time
+
+from hal5_cobs import cobs_decode, cobs_encode
+
+FRAME_START = 0x02
+LOG_START = 0x01
+FRAME_END = 0x00
+
+def crc16(data):
+    # CRC-16/CCITT-FALSE
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+def encode_frame(type, seq, data):
+    payload = struct.pack('<BH', type, seq & 0xFFFF) + data
+    payload += struct.pack('<H', crc16(payload))
+    return bytes([FRAME_START]) + cobs_encode(payload) + bytes([FRAME_END])
+
+class Decoder:
+
+    def __init__(self):
+        self.frames = 0
+        self.lost = 0
+        self.crc_errors = 0
+        self.invalid = 0
+        self.next_seq = None
+        self.start = None
+        self.record = bytearray()
+        self.text = bytearray()
+
+    def _frame(self, record):
+        payload = cobs_decode(record)
+        if payload is None or len(payload) < 5:
+            self.invalid += 1
+            return None
+        if crc16(payload[:-2]) != struct.unpack_from('<H', payload, len(payload) - 2)[0]:
+            self.crc_errors += 1
+            return None
+        type, seq = struct.unpack_from('<BH', payload, 0)
+        if self.next_seq is not None:
+            self.lost += (seq - self.next_seq) & 0xFFFF
+        self.next_seq = (seq + 1) & 0xFFFF
+        self.frames += 1
+        return ('frame', type, seq, payload[3:-2])
+
+    def feed(self, data):
+        events = []
+        for b in data:
+            if self.start is not None:
+                if b == FRAME_END:
+                    if self.start == FRAME_START:
+                        event = self._frame(bytes(self.record))
+                        if event is not None:
+                            events.append(event)
+                    else:
+                        events.append(('log', bytes(self.record)))
+                    self.start = None
+                    self.record = bytearray()
+                else:
+                    self.record.append(b)
+            elif b == FRAME_START or b == LOG_START:
+                if self.text:
+                    events.append(('text', bytes(self.text)))
+                    self.text = bytearray()
+                self.start = b
+            else:
+                self.text.append(b)
+        if self.text:
+            events.append(('text', bytes(self.text)))
+            self.text = bytearray()
+        return events
+
+# frames of the C encoder, hal5_telemetry_encode in hal5_telemetry_frame.c
+# (type, seq, data, frame), keep in sync with the vectors there
+C_VECTORS = [
+    (0x10, 0x0000, b'',
+        bytes.fromhex('0202100103ff8f00')),
+    (0x7F, 0x1234, bytes([0x00, 0x01, 0x02, 0x00, 0xFF]),
+        bytes.fromhex('02047f341203010204ff5b5700')),
+]
+
+def check_vectors():
+    ok = True
+    for type, seq, data, frame in C_VECTORS:
+        decoder = Decoder()
+        events = decoder.feed(frame)
+        if events != [('frame', type, seq, data)]:
+            ok = False
+        if encode_frame(type, seq, data) != frame:
+            ok = False
+    print('C encoder vectors: %s' % ('OK' if ok else 'FAIL'))
+    return ok
+
+def loopback():
+    nframes = 20000
+    # every 1000th frame is not sent, every 1500th frame is corrupted
+    # loss is detected by the next frame, so the last frame is not lost
+    lost = [i for i in range(nframes) if (i % 1000) == 500]
+    corrupted = [i for i in range(nframes)
+            if (i % 1500) == 1499 and i not in lost]
+
+    r, w = os.pipe()
+
+    def writer():
+        with os.fdopen(w, 'wb') as f:
+            for i in range(nframes):
+                if (i % 100) == 0:
+                    f.write(b'text line %d\n' % i)
+                if i in lost:
+                    continue
+                frame = bytearray(encode_frame(1, i, struct.pack('<IIhh', i, i * 3, -i & 0x7FFF, 7)))
+                if i in corrupted:
+                    # a data byte is changed, COBS framing is still valid
+                    frame[5] ^= 0x40 if frame[5] != 0x40 else 0x01
+                f.write(frame)
+
+    t = threading.Thread(target=writer)
+    start = time.time()
+    t.start()
+
+    decoder = Decoder()
+    nbytes = 0
+    ntext = 0
+    with os.fdopen(r, 'rb') as f:
+        while True:
+            data = f.read(4096)
+            if not data:
+                break
+            nbytes += len(data)
+            for event in decoder.feed(data):
+                if event[0] == 'text':
+                    ntext += 1
+
+    t.join()
+    elapsed = time.time() - start
+
+    print('frames: %d, lost: %d, crc errors: %d, invalid: %d' %
+            (decoder.frames, decoder.lost, decoder.crc_errors, decoder.invalid))
+    print('%d bytes in %.2f s, %.0f frames/s, %.0f KB/s' %
+            (nbytes, elapsed, decoder.frames / elapsed, nbytes / elapsed / 1024))
+
+    # a corrupted frame is counted as a crc error, and as lost by the next one
+    ok = (decoder.frames == nframes - len(lost) - len(corrupted)) and \
+            (decoder.crc_errors == len(corrupted)) and \
+            (decoder.lost == len(lost) + len(corrupted)) and \
+            (ntext > 0)
+    print('loopback: %s' % ('OK' if ok else 'FAIL'))
+    return check_vectors() and ok
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == '--loopback':
+        sys.exit(0 if loopback() else 1)
+
+    f = open(sys.argv[1], 'rb', buffering=0) if len(sys.argv) > 1 \
+            else sys.stdin.buffer
+    out = sys.stdout
+    decoder = Decoder()
+
+    while True:
+        data = f.read(256)
+        if not data:
+            break
+        for event in decoder.feed(data):
+            if event[0] == 'frame':
+                out.write('%u %u %s\n' % (event[1], event[2], event[3].hex()))
+            elif event[0] == 'text':
+                out.write(event[1].decode(errors='replace'))
+        out.flush()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal5.h"
+#include "hal5_private.h"
+
+// frame encoding is kept separate from the console output
+// so it can also be compiled and tested on a PC (make host-test)
+
+// a frame is sent as:
+// 0x02, COBS encoded payload, 0x00
+// payload is:
+// type (1 byte), sequence number (2 bytes, LE), data,
+// CRC-16/CCITT-FALSE of type, sequence number and data (2 bytes, LE)
+// console text never contains 0x02 or 0x00, so frames can be mixed
+// with printf output and HAL5_LOG records (which start with 0x01)
+
+#define FRAME_START 0x02
+#define FRAME_END 0x00
+
+#define PAYLOAD_MAX (1 + 2 + HAL5_TELEMETRY_MAX_LEN + 2)
+
+// CRC-16/CCITT-FALSE, poly 0x1021, init 0xFFFF, 4-bit table
+static uint16_t crc16(
+        const uint8_t* data,
+        const uint32_t len)
+{
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+
+    uint16_t crc = 0xFFFF;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+
+    return crc;
+}
+
+uint32_t hal5_telemetry_encode(
+        const uint8_t type,
+        const uint16_t sequence,
+        const void* data,
+        const uint32_t len,
+        uint8_t* frame)
+{
+    assert (len <= HAL5_TELEMETRY_MAX_LEN);
+    assert (frame != NULL);
+
+    uint8_t payload[PAYLOAD_MAX];
+
+    payload[0] = type;
+    payload[1] = sequence & 0xFF;
+    payload[2] = sequence >> 8;
+
+    const uint8_t* p = data;
+    for (uint32_t i = 0; i < len; i++) payload[3 + i] = p[i];
+
+    const uint16_t crc = crc16(payload, 3 + len);
+    payload[3 + len] = crc & 0xFF;
+    payload[4 + len] = crc >> 8;
+
+    // payload is less than 254 bytes, so COBS needs only one overhead byte
+    frame[0] = FRAME_START;
+    uint32_t n = 1 + hal5_cobs_encode(payload, 5 + len, &frame[1]);
+    frame[n++] = FRAME_END;
+
+    return n;
+}
+
+#ifdef HAL5_TELEMETRY_TESTS
+
+// frames of the C encoder, also decoded by hal5_telemetry.py --loopback
+// keep both in sync
+
+static const uint8_t vector_data_1[] = {0x00, 0x01, 0x02, 0x00, 0xFF};
+
+static const uint8_t vector_frame_0[] = {
+    0x02, 0x02, 0x10, 0x01, 0x03, 0xff, 0x8f, 0x00
+};
+
+static const uint8_t vector_frame_1[] = {
+    0x02, 0x04, 0x7f, 0x34, 0x12, 0x03, 0x01, 0x02,
+    0x04, 0xff, 0x5b, 0x57, 0x00
+};
+
+typedef struct
+{
+    uint8_t type;
+    uint16_t sequence;
+    const uint8_t* data;
+    uint32_t len;
+    const uint8_t* frame;
+    uint32_t frame_len;
+} vector_t;
+
+static const vector_t vectors[] = {
+    {0x10, 0x0000, NULL, 0, vector_frame_0, sizeof(vector_frame_0)},
+    {0x7F, 0x1234, vector_data_1, sizeof(vector_data_1), 
+        vector_frame_1, sizeof(vector_frame_1)},
+};
+
+bool hal5_telemetry_test()
+{
+    uint32_t failed = 0;
+    uint8_t frame[HAL5_TELEMETRY_MAX_FRAME_LEN];
+
+    for (uint32_t i = 0; i < (sizeof(vectors) / sizeof(vector_t)); i++)
+    {
+        const vector_t* v = &vectors[i];
+
+        const uint32_t n = hal5_telemetry_encode(
+                v->type, v->sequence, v->data, v->len, frame);
+
+        if ((n != v->frame_len) || (memcmp(frame, v->frame, n) != 0))
+        {
+            printf("telemetry test %lu FAIL\n", (unsigned long) i);
+            failed++;
+        }
+    }
+
+    // max. length, every data byte is non-zero, 0x00 only at the end
+    uint8_t data[HAL5_TELEMETRY_MAX_LEN];
+    for (uint32_t i = 0; i < sizeof(data); i++) data[i] = (i % 255) + 1;
+
+    const uint32_t n = hal5_telemetry_encode(
+            1, 0xFFFF, data, sizeof(data), frame);
+
+    if ((n > HAL5_TELEMETRY_MAX_FRAME_LEN) || (frame[0] != FRAME_START) ||
+            (memchr(frame, FRAME_END, n - 1) != NULL) ||
+            (frame[n - 1] != FRAME_END))
+    {
+        printf("telemetry test FAIL: max. length\n");
+        failed++;
+    }
+
+    printf("telemetry tests: %s\n", (failed == 0) ? "OK" : "FAIL");
+
+    return (failed == 0);
+}
+
+#endif
@@ -29,7 +29,7 @@ extern "C" {
 // see main.c and startup_stm32h5xx.c for example
 // pc contains where fault happened
 // lr contains 
-typedef __PACKED_STRUCT
+typedef struct __attribute__((packed))
 {
     uint32_t r0;
     uint32_t r1;
@@ -40,6 +40,63 @@ typedef __PACKED_STRUCT
     uint32_t pc;
 } hal5_exception_stack_frame_t;
 
+// CONSOLE
+
+// a fixed size text region on the console
+// cells are written to buffer, only the cells different than
+// shadow (what the terminal shows) are sent when it is drawn
+typedef struct
+{
+    // top left position on the terminal, 1-based
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    // width * height chars each, row by row
+    char* buffer;
+    char* shadow;
+    // in ms, hal5_ticks
+    uint32_t refresh_interval;
+    uint32_t last_refresh;
+    // number of bytes sent to the console by draw
+    uint32_t bytes_sent;
+} hal5_console_screen_t;
+
+// DMA
+
+// GPDMA1 channels are statically assigned to their users
+typedef enum
+{
+    hal5_dma_channel_hash,
+    hal5_dma_channel_lpuart1_tx,
+    // tx and rx of an instance are consecutive
+    hal5_dma_channel_i2c1_tx,
+    hal5_dma_channel_i2c1_rx,
+    hal5_dma_channel_i2c2_tx,
+    hal5_dma_channel_i2c2_rx,
+    hal5_dma_channel_i2c3_tx,
+    hal5_dma_channel_i2c3_rx,
+} hal5_dma_channel_t;
+
+typedef enum
+{
+    hal5_dma_request_hash_in,
+    hal5_dma_request_lpuart1_tx,
+    // tx and rx of an instance are consecutive
+    hal5_dma_request_i2c1_tx,
+    hal5_dma_request_i2c1_rx,
+    hal5_dma_request_i2c2_tx,
+    hal5_dma_request_i2c2_rx,
+    hal5_dma_request_i2c3_tx,
+    hal5_dma_request_i2c3_rx,
+} hal5_dma_request_t;
+
+typedef enum
+{
+    hal5_dma_width_byte,
+    hal5_dma_width_halfword,
+    hal5_dma_width_word,
+} hal5_dma_width_t;
 
 // FLASH
 typedef enum
@@ -141,6 +198,235 @@ typedef enum
     hal5_hash_sha2_512,
 } hal5_hash_algorithm_t;
 
+// one message of hal5_hash_batch_sequential
+// digest has space for the digest size
+typedef struct
+{
+    const uint8_t* data;
+    uint32_t len;
+    uint8_t* digest;
+} hal5_hash_job_t;
+
+// number of HASH_CSRx context swap registers, HASH_CSR0 to HASH_CSR102
+// checked against HASH_TypeDef in hal5_hash.c
+#define HAL5_HASH_CSR_COUNT 103
+
+// words in a SHA-512 block, the largest block
+#define HAL5_HASH_MAX_BLOCK_WORDS 32
+
+// a hash stream, fields are internal
+typedef struct
+{
+    hal5_hash_algorithm_t algorithm;
+    uint32_t block_size;
+    uint32_t max_word_index;
+    uint32_t nblw;
+    // words not written to DIN yet, DIN is written only in groups of
+    // expected words (NBWE), so HASH is at a block boundary between calls
+    uint32_t expected;
+    uint32_t npending;
+    uint32_t pending[HAL5_HASH_MAX_BLOCK_WORDS + 1];
+    // bytes of an incomplete word left from hal5_hash_update_buffer
+    // these are written to DIN in the next call or in finalize
+    uint32_t partial_word;
+    uint32_t partial_len;
+    // key is written again in the outer hmac phase
+    bool hmac;
+    const uint8_t* key;
+    uint32_t key_len;
+    // false while DMA or interrupt driven hashing is running
+    volatile bool completed;
+    // peripheral context, valid when suspended
+    bool suspended;
+    uint32_t imr;
+    uint32_t str;
+    uint32_t cr;
+    uint32_t csr[HAL5_HASH_CSR_COUNT];
+    uint8_t digest[64];
+} hal5_hash_ctx_t;
+
+// incremental hashing of a memory region, fields are internal
+typedef struct hal5_hash_scanner_s
+{
+    hal5_hash_ctx_t ctx;
+    hal5_hash_algorithm_t algorithm;
+    const uint8_t* start;
+    uint32_t len;
+    uint32_t offset;
+    uint32_t slice_size;
+    const uint8_t* reference;
+    void (*mismatch_callback)(struct hal5_hash_scanner_s* scanner);
+    // statistics
+    uint32_t passes;
+    uint32_t mismatches;
+    uint32_t max_step_cycles;
+} hal5_hash_scanner_t;
+
+// one buffer of a DMA chain
+// all buffers except the last one must be a multiple of 4 bytes
+// DMA only reads the whole words of the last one, its last partial word 
+// is written by the CPU, so nothing is read past the end of a buffer
+typedef struct
+{
+    const uint8_t* data;
+    uint32_t len;
+} hal5_hash_buffer_t;
+
+// hashes the messages of hal5_hash_cavp_run, one message at a time
+// the HASH peripheral on the MCU, a software SHA in the host tests
+typedef struct
+{
+    void (*init)(const hal5_hash_algorithm_t algorithm);
+    void (*update)(const uint8_t* data, const uint32_t len);
+    bool (*finalize_and_compare)(const uint8_t* expected, const uint32_t len);
+} hal5_hash_backend_t;
+
+// DRBG
+
+#define HAL5_DRBG_BLOCKS 4
+
+typedef struct
+{
+    uint32_t key[8];
+    // HAL5_DRBG_BLOCKS ChaCha20 blocks, first 8 words are the next key
+    uint32_t buffer[HAL5_DRBG_BLOCKS * 16];
+    // byte index of the next unused output in buffer
+    uint32_t position;
+    uint32_t reseed_interval;
+    uint32_t generated;
+} hal5_drbg_t;
+
+// I2C
+
+typedef enum
+{
+    hal5_i2c_ok,
+    // address or data is not acknowledged
+    hal5_i2c_nack,
+    // no progress in HAL5_I2C_TIMEOUT ms, peripheral is reset
+    hal5_i2c_timeout,
+    hal5_i2c_arbitration_lost,
+    // misplaced START or STOP
+    hal5_i2c_bus_error,
+    // job states in the queue
+    hal5_i2c_pending,
+    hal5_i2c_active,
+    hal5_i2c_cancelled,
+} hal5_i2c_status_t;
+
+// a transaction in the I2C queue
+// write tx_len bytes (if not 0), then read rx_len bytes (if not 0)
+// with a repeated START in between
+typedef struct hal5_i2c_job_s
+{
+    uint8_t address;
+    const uint8_t* tx;
+    uint32_t tx_len;
+    uint8_t* rx;
+    uint32_t rx_len;
+    // ms from the start of the job until it is stopped with timeout
+    // 0 is HAL5_I2C_TIMEOUT plus the time of the bytes at the bus speed
+    uint32_t timeout;
+    // called from the interrupt handler when the job is completed
+    // or from hal5_i2c_poll when it times out
+    void (*callback)(struct hal5_i2c_job_s* job);
+    // pending, active, then the result
+    volatile hal5_i2c_status_t status;
+} hal5_i2c_job_t;
+
+// bus clear steps, see hal5_i2c_poll
+typedef enum
+{
+    hal5_i2c_recovery_none,
+    // SCL and SDA are GPIO, released (high)
+    hal5_i2c_recovery_released,
+    hal5_i2c_recovery_scl_low,
+    hal5_i2c_recovery_scl_high,
+    // STOP, SDA goes high while SCL is high
+    hal5_i2c_recovery_stop_scl_low,
+    hal5_i2c_recovery_stop_sda_low,
+    hal5_i2c_recovery_stop_scl_high,
+} hal5_i2c_recovery_t;
+
+// max. number of jobs in the queue of an instance, power of 2
+#define HAL5_I2C_QUEUE_SIZE 16
+
+// an I2C instance (I2C1 to I2C4), see hal5_i2c_init
+// fields are private to hal5_i2c.c
+typedef struct
+{
+    // 1 to 4
+    uint32_t n;
+    hal5_gpio_pin_t scl;
+    hal5_gpio_pin_t sda;
+    hal5_gpio_af_t af;
+    // max. actual bus speed after configure
+    uint32_t speed;
+    bool dma_enabled;
+    // interrupt driven job queue
+    // queue[queue_tail] is the active job, queue_head is the next free slot
+    // both are free running
+    hal5_i2c_job_t* volatile queue[HAL5_I2C_QUEUE_SIZE];
+    volatile uint32_t queue_head;
+    volatile uint32_t queue_tail;
+    bool queue_enabled;
+    // hal5_ticks when the active job is started
+    uint32_t job_started;
+    // position in the current phase of the active job
+    uint32_t job_index;
+    // false during the write phase, true during the read phase
+    bool job_reading;
+    // bytes of the current phase not yet given to NBYTES
+    uint32_t job_nbytes_left;
+    // bus clear after a timeout, one step per hal5_i2c_poll call
+    hal5_i2c_recovery_t recovery;
+    uint32_t recovery_clocks;
+    // hal5_ticks of the last step
+    uint32_t recovery_step_ticks;
+} hal5_i2c_t;
+
+// TIMINGR fields, register values (SCLL + 1 is the number of tPRESC)
+// tPRESC = (PRESC + 1) / i2c_ker_ck
+typedef struct
+{
+    uint32_t presc;
+    uint32_t scll;
+    uint32_t sclh;
+    uint32_t sdadel;
+    uint32_t scldel;
+    // max. actual bus speed (with the min. synchronization delays)
+    uint32_t speed;
+    // all fields combined
+    uint32_t timingr;
+} hal5_i2c_timing_t;
+
+// LPUART
+
+// what hal5_lpuart_write does when TX buffer is full
+typedef enum
+{
+    // new character is dropped
+    hal5_lpuart_overflow_drop,
+    // waits until there is space
+    hal5_lpuart_overflow_block,
+    // oldest character in the buffer is dropped
+    hal5_lpuart_overflow_overwrite,
+} hal5_lpuart_overflow_t;
+
+// LPUART1 baud rate is 256 * lpuart1_ker_ck / (PRESC * BRR)
+typedef struct
+{
+    // divider, 1 to 256
+    uint32_t presc;
+    // PRESC.PRESCALER value
+    uint32_t presc_bits;
+    uint32_t brr;
+    // actual baud rate
+    uint32_t baud;
+    // (actual - requested) / requested, in ppm
+    int32_t error_ppm;
+} hal5_lpuart_brr_t;
+
 // PWR
 
 typedef enum 
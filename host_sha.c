@@ -0,0 +1,375 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// software SHA-1 and SHA-2 (FIPS 180-4), reference for the host tests
+// written for clarity, not for speed
+
+#include <assert.h>
+#include <string.h>
+
+#include "host_sha.h"
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t K512[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f,
+    0xe9b5dba58189dbbc, 0x3956c25bf348b538, 0x59f111f1b605d019,
+    0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242,
+    0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+    0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3,
+    0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65, 0x2de92c6f592b0275,
+    0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+    0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f,
+    0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc,
+    0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+    0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6,
+    0x92722c851482353b, 0xa2bfe8a14cf10364, 0xa81a664bbc423001,
+    0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+    0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99,
+    0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb,
+    0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc,
+    0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915,
+    0xc67178f2e372532b, 0xca273eceea26619c, 0xd186b8c721c0c207,
+    0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba,
+    0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+    0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a,
+    0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+};
+
+static const uint32_t IV_SHA1[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+static const uint32_t IV_SHA224[8] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4,
+};
+
+static const uint32_t IV_SHA256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint64_t IV_SHA384[8] = {
+    0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17,
+    0x152fecd8f70e5939, 0x67332667ffc00b31, 0x8eb44a8768581511,
+    0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4,
+};
+
+static const uint64_t IV_SHA512_224[8] = {
+    0x8c3d37c819544da2, 0x73e1996689dcd4d6, 0x1dfab7ae32ff9c82,
+    0x679dd514582f9fcf, 0x0f6d2b697bd44da8, 0x77e36f7304c48942,
+    0x3f9d85a86a1d36c8, 0x1112e6ad91d692a1,
+};
+
+static const uint64_t IV_SHA512_256[8] = {
+    0x22312194fc2bf72c, 0x9f555fa3c84c64c2, 0x2393b86b6f53b151,
+    0x963877195940eabd, 0x96283ee2a88effe3, 0xbe5e1e2553863992,
+    0x2b0199fc2c85b8aa, 0x0eb72ddc81c52ca2,
+};
+
+static const uint64_t IV_SHA512[8] = {
+    0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b,
+    0xa54ff53a5f1d36f1, 0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+    0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+};
+
+static uint32_t load32(const uint8_t* p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+        ((uint32_t) p[2] << 8) | p[3];
+}
+
+static uint64_t load64(const uint8_t* p)
+{
+    return ((uint64_t) load32(p) << 32) | load32(p + 4);
+}
+
+static void sha1_block(
+        uint32_t* h,
+        const uint8_t* block)
+{
+    uint32_t w[80];
+
+    for (uint32_t i = 0; i < 16; i++) w[i] = load32(block + (i << 2));
+
+    for (uint32_t i = 16; i < 80; i++)
+    {
+        w[i] = ROL32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+    for (uint32_t i = 0; i < 80; i++)
+    {
+        uint32_t f, k;
+
+        if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5a827999; }
+        else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ed9eba1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+        else             { f = b ^ c ^ d;                   k = 0xca62c1d6; }
+
+        const uint32_t t = ROL32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROL32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+static void sha256_block(
+        uint32_t* h,
+        const uint8_t* block)
+{
+    uint32_t w[64];
+
+    for (uint32_t i = 0; i < 16; i++) w[i] = load32(block + (i << 2));
+
+    for (uint32_t i = 16; i < 64; i++)
+    {
+        const uint32_t s0 = ROR32(w[i-15], 7) ^ ROR32(w[i-15], 18) ^
+            (w[i-15] >> 3);
+        const uint32_t s1 = ROR32(w[i-2], 17) ^ ROR32(w[i-2], 19) ^
+            (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t v[8];
+    memcpy(v, h, sizeof(v));
+
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        const uint32_t s1 = ROR32(v[4], 6) ^ ROR32(v[4], 11) ^ ROR32(v[4], 25);
+        const uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        const uint32_t t1 = v[7] + s1 + ch + K256[i] + w[i];
+        const uint32_t s0 = ROR32(v[0], 2) ^ ROR32(v[0], 13) ^ ROR32(v[0], 22);
+        const uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        const uint32_t t2 = s0 + maj;
+
+        memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+
+    for (uint32_t i = 0; i < 8; i++) h[i] += v[i];
+}
+
+static void sha512_block(
+        uint64_t* h,
+        const uint8_t* block)
+{
+    uint64_t w[80];
+
+    for (uint32_t i = 0; i < 16; i++) w[i] = load64(block + (i << 3));
+
+    for (uint32_t i = 16; i < 80; i++)
+    {
+        const uint64_t s0 = ROR64(w[i-15], 1) ^ ROR64(w[i-15], 8) ^
+            (w[i-15] >> 7);
+        const uint64_t s1 = ROR64(w[i-2], 19) ^ ROR64(w[i-2], 61) ^
+            (w[i-2] >> 6);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint64_t v[8];
+    memcpy(v, h, sizeof(v));
+
+    for (uint32_t i = 0; i < 80; i++)
+    {
+        const uint64_t s1 = ROR64(v[4], 14) ^ ROR64(v[4], 18) ^ ROR64(v[4], 41);
+        const uint64_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        const uint64_t t1 = v[7] + s1 + ch + K512[i] + w[i];
+        const uint64_t s0 = ROR64(v[0], 28) ^ ROR64(v[0], 34) ^ ROR64(v[0], 39);
+        const uint64_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        const uint64_t t2 = s0 + maj;
+
+        memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+
+    for (uint32_t i = 0; i < 8; i++) h[i] += v[i];
+}
+
+static void process_block(
+        host_sha_t* sha)
+{
+    switch (sha->algorithm)
+    {
+        case hal5_hash_sha1:
+            sha1_block(sha->h32, sha->block);
+            break;
+
+        case hal5_hash_sha2_224:
+        case hal5_hash_sha2_256:
+            sha256_block(sha->h32, sha->block);
+            break;
+
+        default:
+            sha512_block(sha->h64, sha->block);
+            break;
+    }
+}
+
+void host_sha_init(
+        host_sha_t* sha,
+        const hal5_hash_algorithm_t algorithm)
+{
+    memset(sha, 0, sizeof(host_sha_t));
+
+    sha->algorithm = algorithm;
+    sha->block_size = 128;
+
+    switch (algorithm)
+    {
+        case hal5_hash_sha1:
+            memcpy(sha->h32, IV_SHA1, sizeof(IV_SHA1));
+            sha->block_size = 64;
+            sha->digest_size = 20;
+            break;
+
+        case hal5_hash_sha2_224:
+            memcpy(sha->h32, IV_SHA224, sizeof(IV_SHA224));
+            sha->block_size = 64;
+            sha->digest_size = 28;
+            break;
+
+        case hal5_hash_sha2_256:
+            memcpy(sha->h32, IV_SHA256, sizeof(IV_SHA256));
+            sha->block_size = 64;
+            sha->digest_size = 32;
+            break;
+
+        case hal5_hash_sha2_384:
+            memcpy(sha->h64, IV_SHA384, sizeof(IV_SHA384));
+            sha->digest_size = 48;
+            break;
+
+        case hal5_hash_sha2_512_224:
+            memcpy(sha->h64, IV_SHA512_224, sizeof(IV_SHA512_224));
+            sha->digest_size = 28;
+            break;
+
+        case hal5_hash_sha2_512_256:
+            memcpy(sha->h64, IV_SHA512_256, sizeof(IV_SHA512_256));
+            sha->digest_size = 32;
+            break;
+
+        case hal5_hash_sha2_512:
+            memcpy(sha->h64, IV_SHA512, sizeof(IV_SHA512));
+            sha->digest_size = 64;
+            break;
+
+        default:
+            assert (false);
+    }
+}
+
+void host_sha_update(
+        host_sha_t* sha,
+        const uint8_t* data,
+        uint32_t len)
+{
+    sha->len += len;
+
+    while (len > 0)
+    {
+        sha->block[sha->block_len++] = *data++;
+        len--;
+
+        if (sha->block_len == sha->block_size)
+        {
+            process_block(sha);
+            sha->block_len = 0;
+        }
+    }
+}
+
+void host_sha_final(
+        host_sha_t* sha,
+        uint8_t* out)
+{
+    // message length in bits, 64-bit for SHA-1/256, 128-bit for SHA-512
+    // the upper 64 bits are always zero here
+    const uint64_t bits = sha->len << 3;
+    const uint32_t len_size = (sha->block_size == 64) ? 8 : 16;
+
+    sha->block[sha->block_len++] = 0x80;
+
+    if (sha->block_len > (sha->block_size - len_size))
+    {
+        memset(&sha->block[sha->block_len], 0,
+                sha->block_size - sha->block_len);
+        process_block(sha);
+        sha->block_len = 0;
+    }
+
+    memset(&sha->block[sha->block_len], 0,
+            sha->block_size - sha->block_len);
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        sha->block[sha->block_size - 1 - i] = (uint8_t) (bits >> (i << 3));
+    }
+
+    process_block(sha);
+
+    // big-endian, truncated to the digest size
+    for (uint32_t i = 0; i < sha->digest_size; i++)
+    {
+        if (sha->block_size == 64)
+        {
+            out[i] = (uint8_t) (sha->h32[i >> 2] >> (24 - ((i & 3) << 3)));
+        }
+        else
+        {
+            out[i] = (uint8_t) (sha->h64[i >> 3] >> (56 - ((i & 7) << 3)));
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHA_H__
+#define __HOST_SHA_H__
+
+#include <stdint.h>
+
+#include "hal5.h"
+
+// software SHA-1 and SHA-2, reference for the host tests only
+
+typedef struct
+{
+    hal5_hash_algorithm_t algorithm;
+    uint32_t block_size;
+    uint32_t digest_size;
+    uint32_t h32[8];
+    uint64_t h64[8];
+    uint8_t block[128];
+    uint32_t block_len;
+    uint64_t len;
+} host_sha_t;
+
+void host_sha_init(
+        host_sha_t* sha,
+        const hal5_hash_algorithm_t algorithm);
+
+void host_sha_update(
+        host_sha_t* sha,
+        const uint8_t* data,
+        uint32_t len);
+
+// writes digest_size bytes to out
+void host_sha_final(
+        host_sha_t* sha,
+        uint8_t* out);
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Mete Balci
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2023 Mete Balci
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// tests of the parts not accessing any peripheral, run on a PC
+// built and run with make host-test, HAL5_HOST is defined
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal5.h"
+#include "host_sha.h"
+
+// a table of host_cavp.h, generated by cavp2bin.py --host
+typedef struct
+{
+    const char* name;
+    hal5_hash_algorithm_t algorithm;
+    uint32_t digest_size;
+    const uint8_t* table;
+    uint32_t table_len;
+} host_cavp_table_t;
+
+#include "host_cavp.h"
+
+// hal5_drbg_init and hal5_drbg_reseed take the entropy from RNG
+// tests seed the DRBG themselves, this is only for linking
+uint32_t hal5_rng_random(void)
+{
+    static uint32_t counter = 0;
+    return counter++;
+}
+
+// hal5_hash_cavp_run backend, the software SHA of host_sha.c
+static host_sha_t sha;
+
+static void sha_init(
+        const hal5_hash_algorithm_t algorithm)
+{
+    host_sha_init(&sha, algorithm);
+}
+
+static void sha_update(
+        const uint8_t* data,
+        const uint32_t len)
+{
+    host_sha_update(&sha, data, len);
+}
+
+static bool sha_finalize_and_compare(
+        const uint8_t* expected,
+        const uint32_t len)
+{
+    uint8_t digest[64];
+    host_sha_final(&sha, digest);
+    return memcmp(digest, expected, len) == 0;
+}
+
+static const hal5_hash_backend_t sha_backend = {
+    .init = sha_init,
+    .update = sha_update,
+    .finalize_and_compare = sha_finalize_and_compare,
+};
+
+// the same table walker as cavp_hash_run in hal5_hash.c
+static bool cavp_test(void)
+{
+    bool ok = true;
+
+    const uint32_t ntables = sizeof(host_cavp_tables) / 
+        sizeof(host_cavp_table_t);
+
+    for (uint32_t i = 0; i < ntables; i++)
+    {
+        const host_cavp_table_t* t = &host_cavp_tables[i];
+
+        uint32_t passed = 0;
+        uint64_t bytes = 0;
+
+        const uint32_t failed = hal5_hash_cavp_run(
+                &sha_backend,
+                t->algorithm,
+                t->digest_size,
+                t->table,
+                t->table_len,
+                &passed,
+                &bytes);
+
+        printf("%s passed=%lu failed=%lu\n",
+                t->name, (unsigned long) passed, (unsigned long) failed);
+
+        ok = ok && (failed == 0) && (passed > 0);
+    }
+
+    // a wrong digest has to be found, the last byte of the first table
+    // is the last byte of the digest of the last record
+    static uint8_t corrupted[1 << 16] __attribute__ ((aligned (4)));
+    const host_cavp_table_t* t = &host_cavp_tables[0];
+    assert (t->table_len <= sizeof(corrupted));
+    memcpy(corrupted, t->table, t->table_len);
+    corrupted[t->table_len - 1] ^= 0x01;
+
+    uint32_t passed = 0;
+    uint64_t bytes = 0;
+
+    const uint32_t failed = hal5_hash_cavp_run(
+            &sha_backend,
+            t->algorithm,
+            t->digest_size,
+            corrupted,
+            t->table_len,
+            &passed,
+            &bytes);
+
+    ok = ok && (failed == 1);
+
+    printf("CAVP tables: %s\n", ok ? "OK" : "FAIL");
+
+    return ok;
+}
+
+int main(void)
+{
+    bool ok = true;
+
+    ok = hal5_drbg_test() && ok;
+    ok = hal5_lpuart_brr_test() && ok;
+    ok = hal5_i2c_timing_test() && ok;
+    ok = hal5_telemetry_test() && ok;
+    ok = cavp_test() && ok;
+
+    printf("host tests: %s\n", ok ? "OK" : "FAIL");
+
+    return ok ? 0 : 1;
+}
@@ -45,7 +45,7 @@ void boot(void) {
     hal5_rcc_initialize();
 
     // configure console as early as possible
-    // console uses LPUART1 running with CSI
+    // console uses LPUART1, at 921600 its kernel clock is hsi_ker_ck
     hal5_console_configure(921600, false);
 
     // clear screen and set fg color to red
@@ -117,6 +117,7 @@ void boot(void) {
     bsp_boot_completed();
     printf("Boot completed.\n");
 
+    hal5_console_flush_stdout();
     hal5_console_normal_colors();
 }
 